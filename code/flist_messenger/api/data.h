@@ -107,6 +107,21 @@ struct CharacterData : Character
 	QHash<QString, QString> infoTags;
 };
 
+struct InfotagMapping
+{
+	QString name;
+	QString type; // "text", "number" or "list".
+	QString list; // For "list" infotags, the list their value is taken from.
+	int group;
+};
+
+struct MappingList
+{
+	QHash<QString, InfotagMapping> infotags; // By infotag id.
+	QHash<QString, QString> infotaggroups; // Group names by id.
+	QHash<QString, QString> listitems; // Values for "list" infotags by list item id.
+};
+
 struct CharacterMemo
 {
 	Character character;
@@ -69,4 +69,101 @@ namespace FHttpApi {
         emit succeeded();
     }
 
+    Request<CharacterData> *Endpoint_v1::getCharacterData(cpTicket t, crQString name, DataTypes d) {
+        QHash<QString, QString> params;
+        params.insert("account", t->name);
+        params.insert("ticket", t->ticket);
+        params.insert("name", name);
+
+        QNetworkReply *reply = request(QString(FLIST_BASEURL_CHARACTERDATA), params);
+        return new CharacterDataRequest(reply, d);
+    }
+
+    Endpoint_v1::CharacterDataRequest::CharacterDataRequest(QNetworkReply *qnr, DataTypes requested) : Request<FHttpApi::CharacterData>(qnr), _requested(requested) {}
+
+    void Endpoint_v1::CharacterDataRequest::onRequestFinished() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            // onError() has already reported it.
+            return;
+        }
+        QVariantMap responseMap = QJsonDocument::fromJson(reply->readAll()).toVariant().toMap();
+        QString errnode = responseMap.value("error").toString();
+        if (!errnode.isEmpty()) {
+            emit failed(QString("server_failure"), errnode);
+            return;
+        }
+        if (!responseMap.contains("name")) {
+            emit failed(QString("server_failure"), "Unknown server response. Expected character data.");
+            return;
+        }
+
+        // The endpoint always sends everything; only claim what was asked for.
+        available = _requested;
+        id = responseMap.value("id").toInt();
+        name = responseMap.value("name").toString();
+        description = responseMap.value("description").toString();
+        created = QDateTime::fromSecsSinceEpoch(responseMap.value("created_at").toLongLong());
+        updated = QDateTime::fromSecsSinceEpoch(responseMap.value("updated_at").toLongLong());
+
+        QVariantMap kinkmap = responseMap.value("kinks").toMap();
+        kinks = kinkmap.keys();
+
+        QVariantMap custommap = responseMap.value("custom_kinks").toMap();
+        for (auto cit = custommap.cbegin(); cit != custommap.cend(); ++cit) {
+            QVariantMap customnode = cit.value().toMap();
+            CustomKink custom;
+            custom.name = customnode.value("name").toString();
+            custom.description = customnode.value("description").toString();
+            customKinks.append(custom);
+        }
+
+        QVariantMap infomap = responseMap.value("infotags").toMap();
+        for (auto cit = infomap.cbegin(); cit != infomap.cend(); ++cit) {
+            infoTags.insert(cit.key(), cit.value().toString());
+        }
+
+        emit succeeded();
+    }
+
+    Request<MappingList> *Endpoint_v1::getMappingList() {
+        QNetworkReply *reply = request(QString(FLIST_BASEURL_MAPPINGLIST), QHash<QString, QString>());
+        return new MappingListRequest(reply);
+    }
+
+    Endpoint_v1::MappingListRequest::MappingListRequest(QNetworkReply *qnr) : Request<FHttpApi::MappingList>(qnr) {}
+
+    void Endpoint_v1::MappingListRequest::onRequestFinished() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            return;
+        }
+        QVariantMap responseMap = QJsonDocument::fromJson(reply->readAll()).toVariant().toMap();
+        QString errnode = responseMap.value("error").toString();
+        if (!errnode.isEmpty()) {
+            emit failed(QString("server_failure"), errnode);
+            return;
+        }
+
+        foreach (QVariant node, responseMap.value("infotags").toList()) {
+            QVariantMap infotagnode = node.toMap();
+            InfotagMapping infotag;
+            infotag.name = infotagnode.value("name").toString();
+            infotag.type = infotagnode.value("type").toString();
+            infotag.list = infotagnode.value("list").toString();
+            infotag.group = infotagnode.value("group_id").toInt();
+            infotags.insert(infotagnode.value("id").toString(), infotag);
+        }
+        foreach (QVariant node, responseMap.value("infotag_groups").toList()) {
+            QVariantMap groupnode = node.toMap();
+            infotaggroups.insert(groupnode.value("id").toString(), groupnode.value("name").toString());
+        }
+        foreach (QVariant node, responseMap.value("listitems").toList()) {
+            QVariantMap itemnode = node.toMap();
+            listitems.insert(itemnode.value("id").toString(), itemnode.value("value").toString());
+        }
+
+        emit succeeded();
+    }
+
 } // namespace FHttpApi
@@ -26,6 +26,29 @@ namespace FHttpApi {
                     QString _un;
                     QString _p;
             };
+
+            virtual Request<CharacterData> *getCharacterData(cpTicket t, crQString name, DataTypes d = Data_QuickProfile);
+
+            class CharacterDataRequest : public Request<CharacterData> {
+                public:
+                    CharacterDataRequest(QNetworkReply *qnr, DataTypes requested);
+
+                public slots:
+                    virtual void onRequestFinished();
+
+                private:
+                    DataTypes _requested;
+            };
+
+            virtual Request<MappingList> *getMappingList();
+
+            class MappingListRequest : public Request<MappingList> {
+                public:
+                    MappingListRequest(QNetworkReply *qnr);
+
+                public slots:
+                    virtual void onRequestFinished();
+            };
     };
 
 } // namespace FHttpApi
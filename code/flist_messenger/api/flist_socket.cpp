@@ -1,5 +1,7 @@
 #include "flist_socket.h"
 
+#include <QJsonDocument>
+
 FSocket::FSocket(QString host, QObject *parent) : QObject{parent} {
     m_host = host;
 
@@ -9,19 +11,46 @@ FSocket::FSocket(QString host, QObject *parent) : QObject{parent} {
     connect(m_socket, SIGNAL(textMessageReceived(QString)), this, SLOT(wSocketReceived(QString)));
     connect(m_socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(wSocketError(QAbstractSocket::SocketError)));
     connect(m_socket, SIGNAL(sslErrors(QList<QSslError>)), this, SLOT(wSocketSSLErrors(QList<QSslError>)));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(wSocketDisconnected()));
+    connect(m_socket, SIGNAL(pong(quint64, QByteArray)), this, SLOT(wSocketPong(quint64, QByteArray)));
+
+    // Parented so it follows the socket to the network thread.
+    m_keepAliveTimer = new QTimer(this);
+    connect(m_keepAliveTimer, SIGNAL(timeout()), this, SLOT(wKeepAlive()));
+}
+
+FServerFrame FSocket::decodeFrame(QString message) {
+    FServerFrame frame;
+    frame.raw = message.toStdString();
+    frame.command = frame.raw.substr(0, 3);
+    if (frame.raw.length() > 4) {
+        frame.fields = QJsonDocument::fromJson(QByteArray(frame.raw.data() + 4, frame.raw.length() - 4)).toVariant().toMap();
+    }
+    return frame;
+}
 
-    connect(&m_keepAliveTimer, SIGNAL(timeout()), this, SLOT(wKeepAlive()));
+bool FSocket::takeFrame(FServerFrame &frame) {
+    if (m_frames.pop(frame)) {
+        return true;
+    }
+    m_framesSignalled.store(false);
+    // A frame pushed between the failed pop and clearing the flag would otherwise go unannounced.
+    return m_frames.pop(frame);
 }
 
 void FSocket::socketConnect() {
     qDebug() << "FSocket::socketConnect() - Opening connection to host:" << QUrl(m_host);
+    if (m_open || m_connecting) {
+        return;
+    }
+    m_connecting = true;
     m_socket->open(QUrl(m_host));
 }
 
 void FSocket::send(QString message) {
-    if (m_socket == nullptr) {
-        qDebug() << "FSocket::send() - Send was called but socket was destroyed earlier.";
-        emit socketSSLErrors("Socket invalid, please reconnect.");
+    if (!m_open) {
+        qDebug() << "FSocket::send() - Send was called but the socket is not open.";
+        return;
     }
 
     qDebug() << "FSocket::send() - Socket sending message:" << message;
@@ -33,13 +62,21 @@ void FSocket::send(QString message) {
 void FSocket::wSocketConnected() {
     qDebug() << "FSocket::wSocketConnected() - Socket connected.";
 
+    m_connecting = false;
+    m_open = true;
+    startKeepAlive();
     emit socketConnected();
 }
 
 void FSocket::wSocketReceived(QString message) {
     // qDebug() << "FSocket::wSocketReceived() - Socket recieved message:" << message;
+    m_lastActivity.restart();
 
-    emit socketReceived(message);
+    // Decoding here keeps the JSON parsing of large bursts like LIS off the GUI thread.
+    m_frames.push(decodeFrame(message));
+    if (!m_framesSignalled.exchange(true)) {
+        emit framesReady();
+    }
 }
 
 void FSocket::wSocketSSLErrors(QList<QSslError> errors) {
@@ -63,27 +100,53 @@ void FSocket::wSocketError(QAbstractSocket::SocketError error) {
     QString errorType = metaEnum.valueToKey(error);
     qDebug() << "FSocket::wSocketError() - Socket encountered error. ->" << errorType;
 
-    m_socket->abort();
-    m_socket->deleteLater();
-    m_socket = nullptr;
+    fail(errorType);
+}
+
+void FSocket::wSocketDisconnected() {
+    // A clean close from the server reports no error, but the session still needs to hear about it.
+    fail("RemoteHostClosedError");
+}
 
-    emit socketError(errorType);
+void FSocket::wSocketPong(quint64 elapsed, QByteArray payload) {
+    (void)elapsed;
+    (void)payload;
+    m_lastActivity.restart();
 }
 
 void FSocket::wKeepAlive() {
+    if (m_lastActivity.elapsed() > DeadPeerTimeout) {
+        qDebug() << "FSocket::wKeepAlive() - Nothing heard from the server in" << m_lastActivity.elapsed() << "ms, dropping the connection.";
+        fail("Timed out waiting for the server");
+        return;
+    }
     qDebug() << "FSocket::wKeepAlive() - Pinging server.";
     m_socket->ping();
 }
 
+// Report the first failure of a connection attempt and reset so the socket can be opened again.
+void FSocket::fail(QString error) {
+    if (!m_open && !m_connecting) {
+        return;
+    }
+    m_open = false;
+    m_connecting = false;
+    stopKeepAlive();
+    m_socket->abort();
+
+    emit socketError(error);
+}
+
 void FSocket::startKeepAlive() {
-    m_keepAliveTimer.setInterval(30000);
-    m_keepAliveTimer.setSingleShot(false);
+    m_lastActivity.start();
+    m_keepAliveTimer->setInterval(KeepAliveInterval);
+    m_keepAliveTimer->setSingleShot(false);
 
-    m_keepAliveTimer.start();
+    m_keepAliveTimer->start();
 }
 
 void FSocket::stopKeepAlive() {
-    if (m_keepAliveTimer.isActive()) {
-        m_keepAliveTimer.stop();
+    if (m_keepAliveTimer->isActive()) {
+        m_keepAliveTimer->stop();
     }
 }
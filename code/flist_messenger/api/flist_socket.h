@@ -3,19 +3,53 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QWebSocket>
 #include <QMetaEnum>
+#include <QVariantMap>
+#include <atomic>
+#include <string>
 
+#include "flist_spscqueue.h"
+
+// A frame from the server, split into its command and decoded fields.
+class FServerFrame {
+    public:
+        std::string raw;
+        std::string command;
+        QVariantMap fields;
+};
+
+// Wraps the chat websocket. The same socket is reopened on every connect, so
+// a session can reconnect after an error without rebuilding its FSocket.
+//
+// While open it pings the server every KeepAliveInterval. A connection that
+// has delivered nothing, neither frames nor pongs, for DeadPeerTimeout is
+// treated as dead and reported through socketError() like any other failure.
+//
+// FSocket is meant to live on a network thread. Incoming frames are decoded
+// there and handed over through a lock-free queue: framesReady() announces
+// that the queue went from empty to non-empty, and the owner then collects
+// everything with takeFrame(). Everything else should be called through
+// queued invocations.
 class FSocket : public QObject {
         Q_OBJECT
     public:
+        static const int KeepAliveInterval = 30000;
+        static const int DeadPeerTimeout = 90000;
+
         FSocket(QString host, QObject* parent = nullptr);
+        // Consumer side of the frame queue. Only one thread may take frames.
+        bool takeFrame(FServerFrame &frame);
+        static FServerFrame decodeFrame(QString message);
+
+    public slots:
         void socketConnect();
         void send(QString message);
 
     signals:
         void socketConnected();
-        void socketReceived(QString);
+        void framesReady();
         void socketSSLErrors(QString errors);
         void socketError(QString error);
 
@@ -24,15 +58,23 @@ class FSocket : public QObject {
         void wSocketReceived(QString message);
         void wSocketSSLErrors(QList<QSslError> errors);
         void wSocketError(QAbstractSocket::SocketError error);
+        void wSocketDisconnected();
+        void wSocketPong(quint64 elapsed, QByteArray payload);
         void wKeepAlive();
 
     private:
         QWebSocket* m_socket;
         QString m_host;
-        QTimer m_keepAliveTimer;
+        QTimer* m_keepAliveTimer;
+        QElapsedTimer m_lastActivity; //< Restarted by every frame and pong from the server.
+        bool m_open = false;
+        bool m_connecting = false;
+        FSpscQueue<FServerFrame> m_frames;
+        std::atomic<bool> m_framesSignalled{false}; //< Set once framesReady() is sent, cleared when the consumer finds the queue empty.
 
         void startKeepAlive();
         void stopKeepAlive();
+        void fail(QString error);
 };
 
 #endif // FLIST_SOCKET_H
@@ -0,0 +1,127 @@
+// Feeds a generated LIS through FSession into the server's FCharacterDirectory and reports what the
+// characters cost. Run as "bench_characters [characters] [sessions]"; the defaults are 100000 and 2.
+//
+// The cost is measured as the growth of the heap (glibc's mallinfo2) or, where that is not available, of the
+// resident set size, across loading the list. That covers everything a character brings with it: the object in
+// its slab, the name, the interned status message and the directory's hash entry. Names are not rendered, so
+// the nameHtml fragments are not part of it. The process exits with 1 if a target is missed.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextStream>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#    include <malloc.h>
+#    define HAVE_MALLINFO2
+#endif
+
+#include "flist_account.h"
+#include "flist_character.h"
+#include "flist_characterdirectory.h"
+#include "flist_global.h"
+#include "flist_server.h"
+#include "flist_session.h"
+
+// The server sends the list in blocks of about this many characters.
+static const int BlockSize = 100;
+// Bytes the first session may use per online character, and each further session on the same server.
+static const double TargetBytesPerCharacter = 256.0;
+static const double TargetBytesPerSharedCharacter = 16.0;
+
+// Bytes in use, and where they were measured.
+static qint64 memoryInUse(QString &source) {
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+    source = "heap";
+    return qint64(info.uordblks + info.hblkhd);
+#else
+    source = "RSS";
+    return residentBytes();
+#endif
+}
+
+static QStringList lisFrames(int characters) {
+    static const char *genders[] = {"Male", "Female", "Herm", "None", "Transgender", "Shemale"};
+    static const char *statuses[] = {"online", "online", "online", "looking", "busy", "away", "dnd"};
+    QStringList frames;
+    QJsonArray block;
+    for (int i = 0; i < characters; i++) {
+        QJsonArray character;
+        character.append(QString("Character %1").arg(i, 6, 10, QChar('0')));
+        character.append(genders[i % 6]);
+        character.append(statuses[i % 7]);
+        // Most characters have no status message, some share a common one and a few have their own.
+        if (i % 20 == 0) {
+            character.append(QString("Looking for a long term story, see profile. (%1)").arg(i));
+        } else if (i % 5 == 0) {
+            character.append(QString("Common status message %1").arg(i % 50));
+        } else {
+            character.append(QString());
+        }
+        block.append(character);
+        if (block.size() == BlockSize || i == characters - 1) {
+            QJsonObject fields;
+            fields["characters"] = block;
+            frames.append("LIS " + QString::fromUtf8(QJsonDocument(fields).toJson(QJsonDocument::Compact)));
+            block = QJsonArray();
+        }
+    }
+    return frames;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    int characters = args.size() > 1 ? args.at(1).toInt() : 100000;
+    int sessions = args.size() > 2 ? args.at(2).toInt() : 2;
+    QTextStream out(stdout);
+
+    QStringList frames = lisFrames(characters);
+    FServer *server = new FServer(nullptr);
+    FAccount *account = server->addAccount();
+    out << "sizeof(FCharacter): " << sizeof(FCharacter) << " bytes\n";
+
+    bool met = true;
+    for (int s = 0; s < sessions; s++) {
+        QString name = QString("Session %1").arg(s);
+        QString source;
+        qint64 before = memoryInUse(source);
+        FSession *session = account->addSession(name);
+        if (session == nullptr) {
+            out << "Could not add session " << s << "\n";
+            break;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        foreach (const QString &frame, frames) {
+            session->wsRecv(frame.toStdString());
+        }
+        qint64 elapsed = timer.elapsed();
+        qint64 after = memoryInUse(source);
+
+        const FCharacterDirectory &directory = server->characters;
+        out << "Session " << (s + 1) << ": " << session->getCharacterCount() << " characters in " << elapsed << " ms\n";
+        out << "  unique characters: " << directory.count() << "\n";
+        out << "  pool reservedBytes(): " << directory.pool().reservedBytes() << "\n";
+        if (before < 0 || after < 0) {
+            out << "  " << source << " can't be measured here\n";
+            continue;
+        }
+        double percharacter = double(after - before) / characters;
+        double target = s == 0 ? TargetBytesPerCharacter : TargetBytesPerSharedCharacter;
+        out << "  " << source << " growth: " << (after - before) << " bytes\n";
+        out << "  bytes per character: " << percharacter << " (target " << target << ")\n";
+        if (percharacter > target) {
+            out << "  target missed\n";
+            met = false;
+        }
+        out.flush();
+    }
+
+    delete server;
+    return met ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+# Benchmarks. Build with qmake from this directory; they link against the client's own code.
+
+CONFIG += qt warn_on console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = bench_characters
+
+include(../flist_messenger.pri)
+
+SOURCES += bench_characters.cpp
@@ -1,8 +1,10 @@
 #include "flist_account.h"
 #include "flist_global.h"
 #include "flist_session.h"
+#include "flist_server.h"
+#include "flist_characterprofile.h"
 
-FAccount::FAccount(QObject *parent, FServer *server) : QObject(parent), username(), password(), valid(false), ticketvalid(false), server(server), ui(0) {}
+FAccount::FAccount(QObject *parent, FServer *server) : QObject(parent), username(), password(), valid(false), ticketvalid(false), ticketReply(0), server(server), ui(0) {}
 
 void FAccount::loginSslErrors(QList<QSslError> sslerrors) {
     qDebug() << sslerrors;
@@ -22,6 +24,7 @@ void FAccount::loginHandle() {
     ticket = loginReply->ticket->ticket;
     delete loginReply->ticket;
     ticketvalid = true;
+    characterprofiles->setTicket(this, ticket);
 
     defaultCharacter = loginReply->defaultCharacter;
     characterList = loginReply->characters;
@@ -48,6 +51,42 @@ void FAccount::loginStart() {
     connect(loginReply, SIGNAL(succeeded()), this, SLOT(loginHandle()));
 }
 
+/**
+Fetch a fresh ticket for reconnecting sessions. Tickets expire, so the one from the original login can't be relied on. Answers with ticketReady() or ticketFailed().
+ */
+void FAccount::refreshTicket() {
+    debugMessage("account->refreshTicket()");
+    if (ticketReply) {
+        return;
+    }
+    ticketvalid = false;
+
+    ticketReply = fapi->getTicket(username, password);
+    connect(ticketReply, SIGNAL(sslErrors(QList<QSslError>)), this, SLOT(loginSslErrors(QList<QSslError>)));
+    connect(ticketReply, SIGNAL(failed(QString, QString)), this, SLOT(onTicketError(QString, QString)));
+    connect(ticketReply, SIGNAL(succeeded()), this, SLOT(ticketHandle()));
+}
+
+void FAccount::ticketHandle() {
+    debugMessage("account->ticketHandle()");
+    ticketReply->deleteLater();
+
+    ticket = ticketReply->ticket->ticket;
+    delete ticketReply->ticket;
+    ticketReply = 0;
+    ticketvalid = true;
+    characterprofiles->setTicket(this, ticket);
+
+    emit ticketReady(this, ticket);
+}
+
+void FAccount::onTicketError(QString error_id, QString error_message) {
+    debugMessage("account->refreshTicket() error!");
+    ticketReply->deleteLater();
+    ticketReply = 0;
+    emit ticketFailed(this, QString("%1 (%2)").arg(error_message, error_id));
+}
+
 void FAccount::loginUserPass(QString user, QString pass) {
     debugMessage("account->loginUserPass()");
     username = user;
@@ -86,7 +125,11 @@ FSession *FAccount::addSession(QString charactername) {
     if (session) {
         return session;
     }
-    // No session found; create it.
+    // No session found; create it, if the server's character directory has room for another one.
+    if (server->characters.sessionCount() >= FCharacterDirectory::MaxSlots) {
+        debugMessage(QString("account->addSession() Too many sessions to connect '%1' as well.").arg(charactername));
+        return 0;
+    }
     debugMessage("account->addSession() [new]");
     session = new FSession(this, charactername, this);
     charactersessions.append(session);
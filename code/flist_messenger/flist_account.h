@@ -37,17 +37,21 @@ class FAccount : public QObject {
     public slots:
         void loginStart();
         void loginUserPass(QString user, QString pass);
+        void refreshTicket();
 
     private slots:
         void loginSslErrors(QList<QSslError> sslerrors);
         void onLoginError(QString error_id, QString error_message);
         void loginHandle();
+        void ticketHandle();
+        void onTicketError(QString error_id, QString error_message);
 
     signals:
         void loginError(FAccount *account, QString errortitle, QString errorsring);
         void loginComplete(FAccount *account);
 
         void ticketReady(FAccount *account, QString ticket);
+        void ticketFailed(FAccount *account, QString error);
 
     public:
         // todo: make this stuff private
@@ -70,6 +74,7 @@ class FAccount : public QObject {
         bool ticketvalid;
 
         FHttpApi::Request<FHttpApi::TicketResponse> *loginReply;
+        FHttpApi::Request<FHttpApi::TicketResponse> *ticketReply; //< Outstanding refreshTicket() request, shared by every session asking for one.
 
     public:
         FServer *server;
@@ -0,0 +1,57 @@
+#include "flist_animationclock.h"
+
+#include <algorithm>
+
+#include "flist_global.h"
+#include "flist_imagecache.h"
+
+FAnimationClock::FAnimationClock(QObject *parent) : QObject(parent) {
+    timer.setInterval(Tick);
+    connect(&timer, SIGNAL(timeout()), this, SIGNAL(tick()));
+    clock.start();
+}
+
+FAnimation FAnimationClock::animation(QUrl url) {
+    FAnimation animation;
+    FDecodedImage decoded = imagecache->decoded(url);
+    if (decoded.isNull()) {
+        return animation;
+    }
+    animation.frames = decoded.frames;
+    for (int i = 0; i < decoded.delays.size(); i++) {
+        animation.duration += decoded.delays.at(i);
+        animation.ends.append(animation.duration);
+    }
+    return animation;
+}
+
+int FAnimationClock::frameAt(const FAnimation &animation) {
+    if (!animation.isAnimated()) {
+        return 0;
+    }
+    int position = clock.elapsed() % animation.duration;
+    return std::upper_bound(animation.ends.constBegin(), animation.ends.constEnd(), position) - animation.ends.constBegin();
+}
+
+void FAnimationClock::setActive(QObject *view, bool active) {
+    if (active) {
+        if (!this->active.contains(view)) {
+            this->active.insert(view);
+            connect(view, SIGNAL(destroyed(QObject *)), this, SLOT(viewDestroyed(QObject *)));
+        }
+    } else if (this->active.remove(view)) {
+        disconnect(view, SIGNAL(destroyed(QObject *)), this, SLOT(viewDestroyed(QObject *)));
+    }
+    if (this->active.isEmpty()) {
+        timer.stop();
+    } else if (!timer.isActive()) {
+        timer.start();
+    }
+}
+
+void FAnimationClock::viewDestroyed(QObject *view) {
+    active.remove(view);
+    if (active.isEmpty()) {
+        timer.stop();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef FLIST_ANIMATIONCLOCK_H
+#define FLIST_ANIMATIONCLOCK_H
+
+#include <QObject>
+#include <QUrl>
+#include <QImage>
+#include <QVector>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// The frames of an image as the image cache holds them, shared rather than
+// copied, and when each of them is due.
+class FAnimation {
+    public:
+        FAnimation() : duration(0) {}
+        bool isNull() const { return frames.isEmpty(); }
+        bool isAnimated() const { return frames.size() > 1; }
+
+        QVector<QImage> frames;
+        QVector<int> ends; //< When each frame stops being shown, in milliseconds from the start of the loop.
+        int duration;
+};
+
+// A single clock driving every animated image in the client.
+//
+// Rather than one QMovie per image per view, frames come decoded from the
+// image cache and every view asks which frame to show at each tick. All
+// copies of an eicon therefore stay in step. Nothing is kept here, so an
+// image the cache revalidates or evicts is never shown stale. The timer only
+// runs while at least one view has an animated image on screen.
+class FAnimationClock : public QObject {
+        Q_OBJECT
+    public:
+        static const int Tick = 20;
+
+        explicit FAnimationClock(QObject *parent = nullptr);
+
+        // The frames of 'url' if the image cache holds it, otherwise a null animation.
+        FAnimation animation(QUrl url);
+        int frameAt(const FAnimation &animation);
+        // Views call this as animated images come on or go off screen.
+        void setActive(QObject *view, bool active);
+
+    signals:
+        void tick();
+
+    private slots:
+        void viewDestroyed(QObject *view);
+
+    private:
+        QTimer timer;
+        QElapsedTimer clock;
+        QSet<QObject *> active;
+};
+
+#endif // FLIST_ANIMATIONCLOCK_H
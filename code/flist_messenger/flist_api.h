@@ -77,7 +77,9 @@ namespace FHttpApi {
             //		/* Acceptable data types:
             //		 * Data_Kinks, Data_Description, Data_CustomKinks, Data_Images, Data_Infotags
             //		 */
-            //		virtual Request<CharacterData> *getCharacterData(cpTicket t, crQString name, DataTypes d = Data_QuickProfile) = 0;
+            virtual Request<CharacterData> *getCharacterData(cpTicket t, crQString name, DataTypes d = Data_QuickProfile) = 0;
+            // Names for the ids used by infotags and kinks. Needs no ticket.
+            virtual Request<MappingList> *getMappingList() = 0;
             //		virtual Request<CharacterMemo> *getCharacterMemo(cpTicket t, int idCharacter) = 0;
             //		virtual Request<void> *setCharacterMemo(cpTicket t, int idCharacter, crQString memo);
 
@@ -20,95 +20,84 @@
 */
 
 #include "flist_avatar.h"
-#include <QNetworkReply>
 #include <QIcon>
-#include <iostream>
+#include "flist_global.h"
+#include "flist_imagecache.h"
 
 FAvatar::FAvatar ( QObject *parent ) :
                 QObject ( parent )
 {
-        manager.setParent ( this );
+        connect ( imagecache, SIGNAL ( imageReady ( QUrl ) ), this, SLOT ( avatarReady ( QUrl ) ) );
+        connect ( imagecache, SIGNAL ( imageFailed ( QUrl ) ), this, SLOT ( avatarFailed ( QUrl ) ) );
 }
 
 QPixmap FAvatar::getAvatar ( QString userName )
 {
-        // WARNING: This function works only if the avatar has already been
-        // cached by another function or a previous call.
-        QString name = userName.toLower();
+        // Returns a null pixmap unless the avatar is already decoded in
+        // memory, but starts loading it so a later call will succeed.
+        QUrl url = FImageCache::avatarUrl ( userName );
+        QImage image = imagecache->image ( url );
 
-        if ( imageHash.contains ( name ) )
+        if ( image.isNull() )
         {
-                return imageHash[name];
+                imagecache->request ( url );
+                return QPixmap();
         }
 
-        QUrl targetUrl ( "https://static.f-list.net/images/avatar/" + name.toLower() + ".png" );
-        connect ( &manager, SIGNAL ( finished ( QNetworkReply* ) ), SLOT ( buttonAvatarReady ( QNetworkReply* ) ) );
-        QNetworkReply* reply = manager.get ( QNetworkRequest ( targetUrl ) );
-        //todo: fix this!
-        reply->ignoreSslErrors();
-        return QPixmap();
+        return QPixmap::fromImage ( image );
 }
 
 void FAvatar::applyAvatarToButton ( QAbstractButton *button, QString name )
 {
-        name = name.toLower();
-        std::cout << "Attempting fetch of icon for " + name.toStdString() + ".\n";
+        QUrl url = FImageCache::avatarUrl ( name );
+        QImage image = imagecache->image ( url );
 
-        if ( imageHash.contains ( name ) )
+        if ( !image.isNull() )
         {
-                button->setIcon ( QIcon ( imageHash[name] ) );
+                button->setIcon ( QIcon ( QPixmap::fromImage ( image ) ) );
                 return;
         }
 
-        QUrl targetUrl ( "https://static.f-list.net/images/avatar/" + name.toLower() + ".png" );
-
-        buttonDownloads.insert ( name, button );
+        // Characters without an avatar keep the default icon rather than waiting for one that won't come.
+        if ( imagecache->hasFailed ( url ) )
+        {
+                return;
+        }
 
-        std::cout << "Beginning download for " + name.toStdString() + ".\n";
-        connect ( &manager, SIGNAL ( finished ( QNetworkReply* ) ), SLOT ( buttonAvatarReady ( QNetworkReply* ) ) );
-        QNetworkReply* reply = manager.get ( QNetworkRequest ( targetUrl ) );
-        //todo: fix this!
-        reply->ignoreSslErrors();
+        // The cache coalesces requests, so several buttons waiting on the same avatar only cost one download.
+        buttonDownloads.insert ( url, button );
+        imagecache->request ( url );
 }
 
-void FAvatar::buttonAvatarReady ( QNetworkReply* reply )
+void FAvatar::avatarFailed ( QUrl url )
 {
-        reply->deleteLater();
-        QString name = reply->url().toString();
-        name.chop ( 4 );         // remove ".png" from the end.
-        name = name.remove ( 0, 40 ); // remove start of url from the beginning.
-        QList<QAbstractButton*> buttonList;
+        // The buttons keep whatever icon they had.
+        buttonDownloads.remove ( url );
+}
 
-        if ( buttonDownloads.values ( name ).length() > 0 )
-        {
-                buttonList = buttonDownloads.values ( name );
-                buttonDownloads.remove ( name );
-        }
-        else
+void FAvatar::avatarReady ( QUrl url )
+{
+        if ( !buttonDownloads.contains ( url ) )
         {
-                std::cout << "Download with no button for " + name.toStdString() + ".\n";
                 return;
         }
 
-        std::cout << "Finished avatar download for " + name.toStdString() + "\n";
+        QList<QPointer<QAbstractButton> > buttonList = buttonDownloads.values ( url );
+        buttonDownloads.remove ( url );
+        QImage image = imagecache->image ( url );
 
-        if ( !reply->error() )
+        if ( image.isNull() )
         {
-                QImage image;
+                return;
+        }
 
-                if ( image.loadFromData ( reply->readAll() ) )
+        QIcon icon ( QPixmap::fromImage ( image ) );
+        foreach ( QPointer<QAbstractButton> button, buttonList )
+        {
+                // The tab may have been closed while the download was running.
+                if ( button )
                 {
-                        QPixmap pixmap = QPixmap::fromImage ( image );
-
-                        if ( !pixmap.isNull() )
-                        {
-                                imageHash[name] = pixmap;
-                                QAbstractButton* button;
-                                foreach ( button, buttonList )
-                                {
-                                        button->setIcon ( QIcon ( pixmap ) );
-                                }
-                        }
+                        button->setIcon ( icon );
                 }
         }
-}
\ No newline at end of file
+}
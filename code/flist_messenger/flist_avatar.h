@@ -27,8 +27,8 @@
 #include <QHash>
 #include <QAbstractButton>
 #include <QUrl>
-#include <QMultiMap>
-#include <QNetworkAccessManager>
+#include <QMultiHash>
+#include <QPointer>
 
 class FAvatar : public QObject
 {
@@ -42,12 +42,12 @@ public:
 signals:
 
 public slots:
-	void buttonAvatarReady ( QNetworkReply* );
+	void avatarReady ( QUrl url );
+	void avatarFailed ( QUrl url );
 
 private:
-	QMultiMap<QString, QAbstractButton*> buttonDownloads;
-	QHash<QString, QPixmap> imageHash;
-	QNetworkAccessManager manager;
+	// Buttons waiting on an avatar, by avatar URL. Images themselves live in the shared image cache.
+	QMultiHash<QUrl, QPointer<QAbstractButton> > buttonDownloads;
 };
 
 #endif // FLIST_AVATAR_H
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <QMap>
 #include "flist_enums.h"
 
@@ -28,6 +29,7 @@ public:
 	bool isCharacterOperator(QString charactername) {return operatorlist.contains(charactername.toLower());}
 	//todo: Figure out a better function name than 'isJoined'.
 	bool isJoined() {return joined;}
+	QStringList getCharacterNames() {return characterlist.values();}
 
 	void addCharacter(QString charactername, bool notify);
 	void removeCharacter(QString charactername);
@@ -22,7 +22,6 @@
 #include "flist_channelpanel.h"
 #include <iostream>
 #include <fstream>
-#include <QDir>
 #include <QStringList>
 #include <QSettings>
 #include <QDateTime>
@@ -86,6 +85,8 @@ FChannelPanel::FChannelPanel(iUserInterface* ui, QString sessionid, QString pane
     typing = TYPING_STATUS_CLEAR;
     typingSelf = TYPING_STATUS_CLEAR;
     input = "";
+    scrollbackRequested = false;
+    scrollbackBefore = QDateTime::currentMSecsSinceEpoch();
     loadSettings();
 }
 
@@ -210,14 +211,24 @@ void FChannelPanel::removeOp(QString& charactername) {
     chanOps.remove(charactername.toLower());
 }
 
-void FChannelPanel::addLine(QString chanLine, bool log) {
-    chanLines.append(chanLine);
+void FChannelPanel::addLine(QString chanLine, bool log, MessageType type) {
+    addLine(FMessage::fromFormatted(chanLine, type, QDateTime::currentMSecsSinceEpoch()), log);
+}
+
+void FChannelPanel::addLine(FMessage message, bool log) {
+    chanLines.append(message);
     // todo: make this configurable
-    while (chanLines.count() > 256) {
+    while (chanLines.count() > MAXLINES) {
         chanLines.pop_front();
     }
     if (log) {
-        logLine(chanLine);
+        FChatLogRecord record;
+        record.timestamp = message.getTimeStamp().toMSecsSinceEpoch();
+        record.sender = message.getSourceCharacter();
+        record.type = message.getMessageType();
+        record.bbcode = message.getRawMessage();
+        record.html = message.getFormattedMessage();
+        logRecord(record);
     }
 }
 
@@ -225,61 +236,31 @@ void FChannelPanel::clearLines() {
     chanLines.clear();
 }
 
-void FChannelPanel::logLine(QString& chanLine) {
-    QString logName, dirName;
-
-    FSession* session = ui->getSession(sessionid);
-    if (session) {
-        logName = escapeFileName(session->character) + "~";
-    }
-
-    switch (chanType) {
-        case FChannel::CHANTYPE_NORMAL:
-            dirName += "public";
-            logName += escapeFileName(chanName);
-            break;
-        case FChannel::CHANTYPE_ADHOC:
-            dirName += "private";
-            logName += QString("%1~%2").arg(escapeFileName(chanName), escapeFileName(chanTitle));
-            break;
-
-        case FChannel::CHANTYPE_PM:
-            dirName += "pm";
-            logName += escapeFileName(chanName);
-            break;
-
-        case FChannel::CHANTYPE_CONSOLE:
-            dirName += "console";
-            logName += escapeFileName(chanName);
-            break;
-        default:
-            logName += escapeFileName(chanName);
-            break;
-    }
-    logName += "~" + QDateTime::currentDateTime().toString("yyyy-MM-dd") + ".html";
-    // To ensure filename compatibility:
-
-    dirName = "./logs/" + dirName + "/";
-
-    QDir::toNativeSeparators(logName);
-
-    if (!QDir().exists(dirName)) {
-        QDir().mkpath(dirName);
+void FChannelPanel::insertScrollback(QList<FChatLogRecord>& records) {
+    // Scrollback goes ahead of whatever arrived while it was loading, and never pushes out live lines.
+    int first = qMax(0, records.count() - (MAXLINES - chanLines.count()));
+    QVector<FMessage> lines;
+    lines.reserve(records.count() - first + chanLines.count());
+    for (int i = first; i < records.count(); i++) {
+        lines.append(FMessage::fromFormatted(records[i].html, records[i].type, records[i].timestamp));
     }
+    lines += chanLines;
+    chanLines = lines;
+}
 
-    logName = dirName + logName;
+// Location of this panel's logs relative to the log directory, without the date suffix.
+QString FChannelPanel::logBaseName() {
+    FSession* session = ui->getSession(sessionid);
+    return FChatLog::baseName(session ? session->character : QString(), chanType, chanName, chanTitle);
+}
 
-    QFile logfile(logName);
-    if (!logfile.open(QFile::WriteOnly | QFile::Append)) {
-        QMessageBox::critical(
-                NULL, "Failed to open log file.",
-                QString("Could not open a log file. This could be caused by bad file permissions, or windows zone protection preventing the write of files.\nLog File: ")
-                        + logName);
-        qApp->exit(1);
+void FChannelPanel::logRecord(FChatLogRecord& record) {
+    FSession* session = ui->getSession(sessionid);
+    if (session) {
+        record.session = session->character;
     }
-    chanLine.append("<br />\n");
-    logfile.write(chanLine.toUtf8());
-    logfile.close();
+    record.panel = panelname;
+    chatlog->append(logBaseName(), record);
 }
 
 void FChannelPanel::updateButtonColor() {
@@ -317,7 +298,6 @@ void FChannelPanel::printChannel(QTextBrowser* textEdit) {
 
     bool doScroll = false;
 
-    QString chanLine;
     QString html = cssStyle;
 
     if (textEdit->verticalScrollBar()->value() == textEdit->verticalScrollBar()->maximum()) {
@@ -325,13 +305,13 @@ void FChannelPanel::printChannel(QTextBrowser* textEdit) {
     }
     QString lines = "";
     int size = chanLines.size() * 6;
-    foreach (chanLine, chanLines) {
-        size += chanLine.length();
+    for (int i = 0; i < chanLines.size(); i++) {
+        size += chanLines[i].getFormattedMessage().length();
     }
     lines.reserve(size);
 
-    foreach (chanLine, chanLines) {
-        lines += chanLine;
+    for (int i = 0; i < chanLines.size(); i++) {
+        lines += chanLines[i].getFormattedMessage();
         lines += "<br />";
     }
     html += lines.left(lines.length() - 6);
@@ -348,12 +328,11 @@ QJsonDocument* FChannelPanel::toJSON() {
     QJsonDocument* result = new QJsonDocument();
     QJsonArray rv;
 
-    QString chanLine;
-    foreach (chanLine, chanLines) {
+    for (int i = 0; i < chanLines.size(); i++) {
         QJsonObject _node;
         _node.insert("type", "chat");
         _node.insert("by", "");
-        _node.insert("html", chanLine);
+        _node.insert("html", chanLines[i].getFormattedMessage());
         rv.append(_node);
     }
 
@@ -61,6 +61,8 @@
 #include <time.h>
 
 #include "flist_channel.h"
+#include "flist_chatlog.h"
+#include "flist_message.h"
 
 class iUserInterface;
 
@@ -153,10 +155,22 @@ class FChannelPanel {
 
         void loadSettings();
 
-        void addLine(QString chanLine, bool log);
+        static const int MAXLINES = 256;
+
+        void addLine(QString chanLine, bool log, MessageType type = MESSAGE_TYPE_SYSTEM);
+        void addLine(FMessage message, bool log);
         void clearLines();
+        void insertScrollback(QList<FChatLogRecord>& records);
+
+        bool getScrollbackRequested() { return scrollbackRequested; }
+
+        void setScrollbackRequested(bool requested) { scrollbackRequested = requested; }
+
+        qint64 getScrollbackBefore() { return scrollbackBefore; }
+
         void emptyCharList();
-        void logLine(QString& chanLine);
+        QString logBaseName();
+        void logRecord(FChatLogRecord& record);
         void printChannel(QTextBrowser* textEdit);
         QPushButton* pushButton;
         static BBCodeParser* bbparser;
@@ -181,10 +195,12 @@ class FChannelPanel {
         QMap<QString, QString> chanOps;
         QString chanowner;
         FChannel::ChannelType chanType;
-        QVector<QString> chanLines;
+        QVector<FMessage> chanLines; // Shared with every other panel showing the same message.
         quint64 chanLastActivity;
         time_t creationTime;
         QStringList keywordlist;
+        bool scrollbackRequested; // Scrollback is only read from the logs once the panel is first shown.
+        qint64 scrollbackBefore;  // Anything logged from here on is already in chanLines.
 
         static QColor colorInactive;
         static QColor colorHighlighted;
@@ -21,20 +21,26 @@
 
 #include "flist_character.h"
 #include <QtCore/QSettings>
+#include <QGuiApplication>
 
 QIcon*	FCharacter::statusIcons[FCharacter::STATUS_MAX];
 QString FCharacter::statusStrings[FCharacter::STATUS_MAX];
 QString FCharacter::genderStrings[FCharacter::GENDER_MAX];
 QColor  FCharacter::genderColors[FCharacter::GENDER_MAX];
+QHash<QString, int> FCharacter::statusMessages;
 
 void FCharacter::initClass()
 {
-	statusIcons[ (quint32)STATUS_ONLINE] = new QIcon ( ":/images/status-default.png" ); //STATUS_ONLINE
-	statusIcons[ (quint32)STATUS_LOOKING] = new QIcon ( ":/images/status.png" ); 		//STATUS_LOOKING
-	statusIcons[ (quint32)STATUS_BUSY] = new QIcon ( ":/images/status-away.png" );		//STATUS_BUSY
-	statusIcons[ (quint32)STATUS_DND] = new QIcon ( ":/images/status-busy.png" );		//STATUS_DND
-	statusIcons[ (quint32)STATUS_CROWN] = new QIcon ( ":/images/crown.png" );			//STATUS_CROWN
-	statusIcons[ (quint32)STATUS_AWAY] = new QIcon( ":/images/status-blue" );			//STATUS_AWAY
+	// Icons need a GUI application; the headless logger runs without one.
+	if ( qobject_cast<QGuiApplication*> ( QCoreApplication::instance() ) )
+	{
+		statusIcons[ (quint32)STATUS_ONLINE] = new QIcon ( ":/images/status-default.png" ); //STATUS_ONLINE
+		statusIcons[ (quint32)STATUS_LOOKING] = new QIcon ( ":/images/status.png" ); 		//STATUS_LOOKING
+		statusIcons[ (quint32)STATUS_BUSY] = new QIcon ( ":/images/status-away.png" );		//STATUS_BUSY
+		statusIcons[ (quint32)STATUS_DND] = new QIcon ( ":/images/status-busy.png" );		//STATUS_DND
+		statusIcons[ (quint32)STATUS_CROWN] = new QIcon ( ":/images/crown.png" );			//STATUS_CROWN
+		statusIcons[ (quint32)STATUS_AWAY] = new QIcon( ":/images/status-blue" );			//STATUS_AWAY
+	}
 
 	statusStrings[ (quint32)STATUS_ONLINE] = "Online";
 	statusStrings[ (quint32)STATUS_LOOKING] = "Looking";
@@ -109,26 +115,58 @@ void FCharacter::initClass()
 
 FCharacter::FCharacter()
 {
+	nameHtmlCache = 0;
 	updateActivityTimer();
 	chatOp = false;
 	charStatus = FCharacter::STATUS_ONLINE;
 	charGender = FCharacter::GENDER_NONE;
-	isFriend = false;
+	sessionMask = 0;
 }
 
-FCharacter::FCharacter ( QString& name, bool friended )
+FCharacter::FCharacter ( QString& name )
 {
 	charName = name;
+	nameHtmlCache = 0;
 	updateActivityTimer();
 	chatOp = false;
-	isFriend = friended;
+	sessionMask = 0;
 	charStatus = FCharacter::STATUS_ONLINE;
 	charGender = FCharacter::GENDER_NONE;
 }
 
+FCharacter::~FCharacter()
+{
+	releaseStatusMsg(statusMessage);
+	delete[] nameHtmlCache;
+}
+
+QString FCharacter::internStatusMsg(const QString &status)
+{
+	if(status.isEmpty())
+		return QString();
+
+	QHash<QString, int>::iterator it = statusMessages.find(status);
+	if(it == statusMessages.end())
+		it = statusMessages.insert(status, 0);
+	it.value()++;
+	return it.key();
+}
+
+void FCharacter::releaseStatusMsg(const QString &status)
+{
+	if(status.isEmpty())
+		return;
+
+	QHash<QString, int>::iterator it = statusMessages.find(status);
+	if(it != statusMessages.end() && --it.value() == 0)
+		statusMessages.erase(it);
+}
+
 void FCharacter::setName ( QString& name )
 {
 	charName = name;
+	delete[] nameHtmlCache;
+	nameHtmlCache = 0;
 }
 
 void FCharacter::updateActivityTimer()
@@ -152,6 +190,7 @@ QIcon* FCharacter::statusIcon()
 void FCharacter::setGender ( QString& gender )
 {
 	QString lgender = gender.toLower();
+	quint32 oldGender = charGender;
 
 	if ( lgender == "male" )
 		charGender = GENDER_MALE;
@@ -171,6 +210,12 @@ void FCharacter::setGender ( QString& gender )
 		charGender = GENDER_MALEHERM;
 	else
 		charGender = GENDER_NONE;
+
+	if ( charGender != oldGender )
+	{
+		delete[] nameHtmlCache;
+		nameHtmlCache = 0;
+	}
 }
 
 QString& FCharacter::genderString()
@@ -225,7 +270,11 @@ QString& FCharacter::statusString()
 
 void FCharacter::setStatusMsg ( QString& status )
 {
-	statusMessage = status;
+	if(status == statusMessage)
+		return;
+	QString interned = internStatusMsg(status);
+	releaseStatusMsg(statusMessage);
+	statusMessage = interned;
 }
 
 void FCharacter::setIsChatOp ( const bool op )
@@ -252,3 +301,27 @@ QString FCharacter::PMTitle()
 
 	return title;
 }
+
+const QString& FCharacter::nameHtml ( nameHtmlVariant variant )
+{
+	if ( !nameHtmlCache )
+	{
+		nameHtmlCache = new QString[NAMEHTML_MAX];
+		QString url = getUrl();
+		for ( int i = 0; i < NAMEHTML_MAX; i++ )
+			nameHtmlCache[i] = buildNameHtml ( genderColor(), url, ( nameHtmlVariant ) i, charName );
+	}
+	return nameHtmlCache[variant];
+}
+
+QString FCharacter::buildNameHtml ( const QColor &color, const QString &url, nameHtmlVariant variant, const QString &name )
+{
+	QString html = "<b><a style=\"color: " + color.name() + "\" href=\"" + url + "\">";
+	// todo: choose a different icon for chat operators
+	if ( variant == NAMEHTML_CHATOP )
+		html += "<img src=\":/images/auction-hammer.png\" /><img src=\":/images/auction-hammer.png\" />";
+	else if ( variant == NAMEHTML_CHANNELOP )
+		html += "<img src=\":/images/auction-hammer.png\" />";
+	html += name; // todo: HTML escape
+	return html;
+}
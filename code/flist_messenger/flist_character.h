@@ -55,13 +55,20 @@ public:
 		GENDER_OFFLINE_UNKNOWN,
 		GENDER_MAX
 	};
+	enum nameHtmlVariant
+	{
+		NAMEHTML_NORMAL,
+		NAMEHTML_CHANNELOP,
+		NAMEHTML_CHATOP,
+		NAMEHTML_MAX
+	};
 	static QIcon*		statusIcons[STATUS_MAX];
 	static QString		statusStrings[STATUS_MAX];
 	static QString		genderStrings[GENDER_MAX];
 	static QColor		genderColors[GENDER_MAX];
 	FCharacter();
-	FCharacter ( QString& name, bool friended );
-	~FCharacter() {}
+	FCharacter ( QString& name );
+	~FCharacter();
 
 	void setName ( QString& name );
 	QString& name()
@@ -72,7 +79,7 @@ public:
 	void setStatus ( QString& status );
 	characterStatus status()
 	{
-		return charStatus;
+		return (characterStatus)charStatus;
 	}
 
 	QString& statusString();
@@ -86,7 +93,7 @@ public:
 	void setGender ( QString& gender );
 	characterGender gender()
 	{
-		return charGender;
+		return (characterGender)charGender;
 	}
 
 	QString& genderString();
@@ -101,45 +108,45 @@ public:
 	{
 		return chatOp;
 	}
-	void setIsFriend(bool b) { isFriend = b; }
-	bool getFriend()
-	{
-		return isFriend;
-	}
-
 	void setIsChatOp ( const bool op );
 	QColor& genderColor();
 	QString PMTitle();
 
 	QString getUrl() {return "https://www.f-list.net/c/" + charName + "/";} //todo: HTTP request character encoding. //todo: Get server address from FServer?
 
-	void clearCustomKinkData() {customkinkdatakeys.clear(); customkinkdata.clear();}
-	void addCustomKinkData(QString key, QString value) {customkinkdatakeys.removeAll(key); customkinkdatakeys.append(key); customkinkdata[key] = value;}
-	QStringList &getCustomKinkDataKeys() {return customkinkdatakeys;}
-	QHash<QString, QString> &getCustomKinkData() {return customkinkdata;}
+	// The character's coloured, linked name without the closing "</a></b>",
+	// so a suffix such as "'s" can still go inside the link. Built on first
+	// use and kept until the gender changes.
+	const QString& nameHtml(nameHtmlVariant variant);
+	static QString buildNameHtml(const QColor &color, const QString &url, nameHtmlVariant variant, const QString &name);
 
-	void clearProfileData() {profiledatakeys.clear(); profiledata.clear();}
-	void addProfileData(QString key, QString value) {profiledatakeys.removeAll(key); profiledatakeys.append(key); profiledata[key] = value;}
-	QStringList &getProfileDataKeys() {return profiledatakeys;}
-	QHash<QString, QString> &getProfileData() {return profiledata;}
-	
 
 	static void initClass();
 
 private:
-	QString				charName;
+	// Status messages are interned: characters with the same message share one copy of it.
+	static QString internStatusMsg(const QString &status);
+	static void releaseStatusMsg(const QString &status);
+	static QHash<QString, int> statusMessages; // Interned status messages and how many characters use each.
+
+	// There are tens of thousands of these per server, so keep them small.
+	QString				charName;		// Shares its data with the key in FCharacterDirectory.
 	QString				statusMessage;
-	characterStatus		charStatus;
-	characterGender		charGender;
+	QString*			nameHtmlCache;	// NAMEHTML_MAX fragments, or null until the name is first rendered.
 	quint32				lastActivity;
-	bool				chatOp;
-	bool				isFriend;
-
-	//todo: The following data should really go in 'FCharacterProfile', but placed here to expediate the transfer of flist_messenger::processCommand()'s functionality into 'FSession'. 'FCharacterProfile' is expected to use the JSON HTTP API to retrieve data and will be less session dependant.
-	QStringList customkinkdatakeys; //<Custom kink keys in the order they were reported by the server
-	QHash<QString, QString> customkinkdata; //Custom kink data.
-	QStringList profiledatakeys; //<Profile keys in the order they were reported by the server
-	QHash<QString, QString> profiledata; //Profile data.
+	quint32				charStatus : 3;
+	quint32				charGender : 4;
+	quint32				chatOp : 1;
+	quint32				sessionMask : 24;	// Which sessions see this character online; owned by FCharacterDirectory.
+
+	friend class FCharacterDirectory;
 };
 
+// Two strings, the name fragment pointer, the activity time and one word of flags and session bits:
+// 64 bytes on 64-bit Qt 6. That is what it was before the flags were packed, as the name fragment
+// pointer took those 8 bytes back. The savings per character come from the slabs and the interned
+// status messages; benchmarks/bench_characters measures them.
+static_assert(sizeof(FCharacter) == 2 * sizeof(QString) + sizeof(QString*) + 2 * sizeof(quint32), "FCharacter has grown");
+static_assert(FCharacter::STATUS_MAX <= (1 << 3) && FCharacter::GENDER_MAX <= (1 << 4), "FCharacter's status or gender field is too narrow");
+
 #endif //flist_character_H
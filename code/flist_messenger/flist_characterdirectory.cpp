@@ -0,0 +1,110 @@
+#include "flist_characterdirectory.h"
+
+#include <QtAlgorithms>
+
+#include "flist_character.h"
+
+FCharacterDirectory::~FCharacterDirectory() {
+    foreach (FCharacter *character, characters) {
+        characterpool.destroy(character);
+    }
+}
+
+int FCharacterDirectory::attach() {
+    for (int slot = 0; slot < MaxSlots; slot++) {
+        if (!(slots & (1u << slot))) {
+            slots |= 1u << slot;
+            slotcounts[slot] = 0;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void FCharacterDirectory::detach(int slot) {
+    if (slot < 0 || slot >= MaxSlots) {
+        return;
+    }
+    quint32 bit = 1u << slot;
+    QHash<QString, FCharacter *>::iterator it = characters.begin();
+    while (it != characters.end()) {
+        if ((*it)->sessionMask & bit) {
+            it = release(it, bit);
+        } else {
+            ++it;
+        }
+    }
+    slots &= ~bit;
+    slotcounts[slot] = 0;
+}
+
+bool FCharacterDirectory::isOnline(int slot, const QString &name) const {
+    return get(slot, name) != nullptr;
+}
+
+FCharacter *FCharacterDirectory::get(int slot, const QString &name) const {
+    if (slot < 0 || slot >= MaxSlots) {
+        return nullptr;
+    }
+    FCharacter *character = characters.value(name);
+    return character && (character->sessionMask & (1u << slot)) ? character : nullptr;
+}
+
+FCharacter *FCharacterDirectory::add(int slot, QString name) {
+    if (slot < 0 || slot >= MaxSlots) {
+        return nullptr;
+    }
+    quint32 bit = 1u << slot;
+    FCharacter *&character = characters[name];
+    if (!character) {
+        character = characterpool.create(name);
+    }
+    if (!(character->sessionMask & bit)) {
+        character->sessionMask |= bit;
+        slotcounts[slot]++;
+    }
+    return character;
+}
+
+void FCharacterDirectory::remove(int slot, const QString &name) {
+    if (slot < 0 || slot >= MaxSlots) {
+        return;
+    }
+    QHash<QString, FCharacter *>::iterator it = characters.find(name);
+    if (it != characters.end() && ((*it)->sessionMask & (1u << slot))) {
+        release(it, 1u << slot);
+    }
+}
+
+/**
+Clear 'bit' on the character at 'it', destroying the character if that was the last session to have it online. Returns the iterator to the next character.
+ */
+QHash<QString, FCharacter *>::iterator FCharacterDirectory::release(QHash<QString, FCharacter *>::iterator it, quint32 bit) {
+    FCharacter *character = *it;
+    character->sessionMask &= ~bit;
+    slotcounts[qCountTrailingZeroBits(bit)]--;
+    if (character->sessionMask == 0) {
+        it = characters.erase(it);
+        characterpool.destroy(character);
+        return it;
+    }
+    return ++it;
+}
+
+QStringList FCharacterDirectory::names(int slot) const {
+    QStringList list;
+    if (slot < 0 || slot >= MaxSlots) {
+        return list;
+    }
+    list.reserve(slotcounts[slot]);
+    for (QHash<QString, FCharacter *>::const_iterator it = characters.begin(); it != characters.end(); ++it) {
+        if ((*it)->sessionMask & (1u << slot)) {
+            list.append(it.key());
+        }
+    }
+    return list;
+}
+
+int FCharacterDirectory::sessionCount() const {
+    return qPopulationCount(slots);
+}
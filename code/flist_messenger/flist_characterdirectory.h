@@ -0,0 +1,58 @@
+#ifndef FLIST_CHARACTERDIRECTORY_H
+#define FLIST_CHARACTERDIRECTORY_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+#include "flist_characterpool.h"
+
+class FCharacter;
+
+// The characters online on a chat server, shared by every session connected
+// to it. Each session attaches to get a slot, and a character is kept for
+// as long as at least one slot has it online: the slots are bits in the
+// character itself, so a second or third session costs nothing per
+// character. Only state that really differs between sessions (friends,
+// ignores, joined rooms) is kept by the sessions.
+class FCharacterDirectory {
+    public:
+        static const int MaxSlots = 24; //< Width of FCharacter's session bits.
+
+        FCharacterDirectory() {}
+        ~FCharacterDirectory();
+
+        // A free slot for a new session, or -1 if every slot is taken.
+        int attach();
+        // Release a slot, dropping the characters only it had online.
+        void detach(int slot);
+
+        bool isOnline(int slot, const QString &name) const;
+        // The character if 'slot' has it online, null otherwise.
+        FCharacter *get(int slot, const QString &name) const;
+        // Mark the character online for 'slot', creating it if no session knew it yet.
+        FCharacter *add(int slot, QString name);
+        // Mark the character offline for 'slot', destroying it once no session has it online.
+        void remove(int slot, const QString &name);
+        // The characters 'slot' has online.
+        QStringList names(int slot) const;
+
+        int count(int slot) const { return slot >= 0 && slot < MaxSlots ? slotcounts[slot] : 0; }
+        // Unique characters, however many sessions see them.
+        int count() const { return characters.count(); }
+        int sessionCount() const;
+        const FCharacterPool &pool() const { return characterpool; }
+
+    private:
+        FCharacterDirectory(const FCharacterDirectory &) = delete;
+        FCharacterDirectory &operator=(const FCharacterDirectory &) = delete;
+
+        QHash<QString, FCharacter *>::iterator release(QHash<QString, FCharacter *>::iterator it, quint32 bit);
+
+        FCharacterPool characterpool;              //< Storage for the characters in 'characters'.
+        QHash<QString, FCharacter *> characters;   //< Every character online for at least one slot.
+        quint32 slots = 0;                         //< Slots in use, one bit each.
+        int slotcounts[MaxSlots] = {};             //< Characters online per slot.
+};
+
+#endif // FLIST_CHARACTERDIRECTORY_H
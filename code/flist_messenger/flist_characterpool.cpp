@@ -0,0 +1,37 @@
+#include "flist_characterpool.h"
+
+#include <new>
+
+#include "flist_character.h"
+
+FCharacterPool::~FCharacterPool() {
+    // Whoever owns the pool destroys the characters; this only returns the memory.
+    foreach (char *slab, slabs) {
+        ::operator delete(slab);
+    }
+}
+
+FCharacter *FCharacterPool::create(QString &name) {
+    void *slot;
+    if (!freeslots.isEmpty()) {
+        slot = freeslots.takeLast();
+    } else {
+        if (slabs.isEmpty() || used == SlabSize) {
+            slabs.append(static_cast<char *>(::operator new(sizeof(FCharacter) * SlabSize)));
+            used = 0;
+        }
+        slot = slabs.last() + sizeof(FCharacter) * used++;
+    }
+    live++;
+    return new (slot) FCharacter(name);
+}
+
+void FCharacterPool::destroy(FCharacter *character) {
+    character->~FCharacter();
+    freeslots.append(character);
+    live--;
+}
+
+qint64 FCharacterPool::reservedBytes() const {
+    return qint64(slabs.size()) * SlabSize * sizeof(FCharacter);
+}
@@ -0,0 +1,41 @@
+#ifndef FLIST_CHARACTERPOOL_H
+#define FLIST_CHARACTERPOOL_H
+
+#include <QString>
+#include <QVector>
+
+class FCharacter;
+
+// Storage for the characters online on a server. Characters are placed in
+// fixed size slabs instead of being allocated one at a time, so a full
+// LIS ends up in a few hundred contiguous blocks rather than one heap
+// block per character. Slots freed by characters going offline are
+// reused before a new slab is started.
+//
+// Pointers stay valid until destroy() is called on them; slabs are never
+// moved or released while the pool is alive.
+class FCharacterPool {
+    public:
+        static const int SlabSize = 512; //< Characters per slab.
+
+        FCharacterPool() {}
+        ~FCharacterPool();
+
+        FCharacter *create(QString &name);
+        void destroy(FCharacter *character);
+
+        int count() const { return live; }
+        // Bytes held by the slabs, used or not. Doesn't include the strings the characters point to.
+        qint64 reservedBytes() const;
+
+    private:
+        FCharacterPool(const FCharacterPool &) = delete;
+        FCharacterPool &operator=(const FCharacterPool &) = delete;
+
+        QVector<char *> slabs;
+        QVector<FCharacter *> freeslots;
+        int used = 0; //< Slots handed out from the last slab so far.
+        int live = 0;
+};
+
+#endif // FLIST_CHARACTERPOOL_H
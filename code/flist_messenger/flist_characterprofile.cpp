@@ -1,6 +1,211 @@
 #include "flist_characterprofile.h"
 
-FCharacterProfile::FCharacterProfile(QObject *parent) :
-    QObject(parent)
-{
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+
+#include "flist_global.h"
+#include "flist_account.h"
+
+static const quint32 ProfileVersion = 1;
+
+FCharacterProfile::FCharacterProfile(QString cachedir, int ttlhours, int maxentries, QObject *parent)
+    : QObject(parent), cachedir(cachedir), ttl(qint64(ttlhours) * 60 * 60 * 1000), memory(maxentries) {}
+
+void FCharacterProfile::setTicket(FAccount *account, QString ticket) {
+    if (this->account != account) {
+        if (this->account) {
+            disconnect(this->account, SIGNAL(ticketFailed(FAccount *, QString)), this, SLOT(ticketFailed(FAccount *, QString)));
+        }
+        this->account = account;
+        connect(account, SIGNAL(ticketFailed(FAccount *, QString)), this, SLOT(ticketFailed(FAccount *, QString)));
+    }
+    this->ticket.name = account->getUserName();
+    this->ticket.ticket = ticket;
+    pump();
+}
+
+QString FCharacterProfile::cachePath(QString key) {
+    QDir dir(cachedir);
+    if (!dir.exists("profiles")) {
+        dir.mkpath("profiles");
+    }
+    return dir.absoluteFilePath("profiles/" + escapeFileName(key));
+}
+
+FCharacterProfileData FCharacterProfile::load(QString key) {
+    FCharacterProfileData profile;
+    QFile file(cachePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return profile;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 version;
+    stream >> version;
+    if (version != ProfileVersion) {
+        return profile;
+    }
+    stream >> profile.fetched >> profile.info >> profile.customkinks;
+    if (stream.status() != QDataStream::Ok) {
+        return FCharacterProfileData();
+    }
+    return profile;
+}
+
+void FCharacterProfile::save(QString key, const FCharacterProfileData &profile) {
+    QSaveFile file(cachePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        debugMessage(QString("[profiles] Could not write the profile for '%1'.").arg(key));
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << ProfileVersion << profile.fetched << profile.info << profile.customkinks;
+    file.commit();
+}
+
+FCharacterProfileData FCharacterProfile::profile(QString name) {
+    QString key = name.toLower();
+    FCharacterProfileData *entry = memory.object(key);
+    if (entry == nullptr) {
+        FCharacterProfileData loaded = load(key);
+        if (loaded.isNull()) {
+            return loaded;
+        }
+        entry = new FCharacterProfileData(loaded);
+        memory.insert(key, entry);
+        entry = memory.object(key);
+        if (entry == nullptr) {
+            return loaded;
+        }
+    }
+    if (QDateTime::currentMSecsSinceEpoch() - entry->fetched >= ttl) {
+        request(name);
+    }
+    return *entry;
+}
+
+void FCharacterProfile::request(QString name) {
+    QString key = name.toLower();
+    if (queued.contains(key) || running.values().contains(key)) {
+        return;
+    }
+    queued.append(key);
+    pump();
+}
+
+void FCharacterProfile::pump() {
+    if (queued.isEmpty() || ticket.ticket.isEmpty()) {
+        return;
+    }
+    if (!mappingready) {
+        // Infotags arrive as ids; nothing can be resolved until the names are known.
+        if (mappingrequest == nullptr) {
+            mappingrequest = fapi->getMappingList();
+            connect(mappingrequest, SIGNAL(succeeded()), this, SLOT(mappingFinished()));
+            connect(mappingrequest, SIGNAL(failed(QString, QString)), this, SLOT(mappingFailed(QString, QString)));
+        }
+        return;
+    }
+    while (running.size() < MaxRequests && !queued.isEmpty()) {
+        QString key = queued.takeFirst();
+        FHttpApi::Request<FHttpApi::CharacterData> *request = fapi->getCharacterData(&ticket, key);
+        running[request] = key;
+        connect(request, SIGNAL(succeeded()), this, SLOT(characterFinished()));
+        connect(request, SIGNAL(failed(QString, QString)), this, SLOT(characterFailed(QString, QString)));
+    }
+}
+
+void FCharacterProfile::mappingFinished() {
+    mapping = *mappingrequest->data();
+    mappingrequest->deleteLater();
+    mappingrequest = nullptr;
+    mappingready = true;
+    pump();
+}
+
+void FCharacterProfile::mappingFailed(QString error_id, QString error_message) {
+    debugMessage(QString("[profiles] Could not get the infotag names: %1 (%2)").arg(error_message, error_id));
+    mappingrequest->deleteLater();
+    mappingrequest = nullptr;
+    // Let everyone waiting know; the next request() tries again.
+    QStringList failed = queued;
+    queued.clear();
+    foreach (QString key, failed) {
+        emit profileFailed(key, error_message);
+    }
+}
+
+FCharacterProfileData FCharacterProfile::resolve(const FHttpApi::CharacterData &data) {
+    FCharacterProfileData profile;
+    profile.fetched = QDateTime::currentMSecsSinceEpoch();
+
+    QStringList ids = data.infoTags.keys();
+    std::sort(ids.begin(), ids.end(), [this](const QString &a, const QString &b) {
+        int groupa = mapping.infotags.value(a).group;
+        int groupb = mapping.infotags.value(b).group;
+        return groupa != groupb ? groupa < groupb : a.toInt() < b.toInt();
+    });
+    foreach (QString id, ids) {
+        FHttpApi::InfotagMapping infotag = mapping.infotags.value(id);
+        QString value = data.infoTags.value(id);
+        if (infotag.type == "list") {
+            value = mapping.listitems.value(value, value);
+        }
+        profile.info.append(qMakePair(infotag.name.isEmpty() ? id : infotag.name, value));
+    }
+    foreach (const FHttpApi::CustomKink &custom, data.customKinks) {
+        profile.customkinks.append(qMakePair(custom.name, custom.description));
+    }
+    return profile;
+}
+
+void FCharacterProfile::characterFinished() {
+    FHttpApi::Request<FHttpApi::CharacterData> *request = static_cast<FHttpApi::Request<FHttpApi::CharacterData> *>(sender());
+    request->deleteLater();
+    QString key = running.take(request);
+    retried.remove(key);
+
+    FCharacterProfileData profile = resolve(*request->data());
+    save(key, profile);
+    memory.insert(key, new FCharacterProfileData(profile));
+    emit profileReady(key);
+    pump();
+}
+
+void FCharacterProfile::characterFailed(QString error_id, QString error_message) {
+    FHttpApi::BaseRequest *request = static_cast<FHttpApi::BaseRequest *>(sender());
+    request->deleteLater();
+    QString key = running.take(request);
+    if (account && error_message.contains("ticket", Qt::CaseInsensitive) && !retried.contains(key)) {
+        // The ticket expired. Hold everything until setTicket() hands over a new one, then try this one again.
+        debugMessage(QString("[profiles] Ticket refused for '%1', fetching a new one: %2").arg(key, error_message));
+        retried.insert(key);
+        queued.prepend(key);
+        ticket.ticket.clear();
+        account->refreshTicket();
+        return;
+    }
+    retried.remove(key);
+    debugMessage(QString("[profiles] Could not get the profile for '%1': %2 (%3)").arg(key, error_message, error_id));
+    emit profileFailed(key, error_message);
+    pump();
+}
+
+void FCharacterProfile::ticketFailed(FAccount *source, QString error) {
+    if (source != account || !ticket.ticket.isEmpty()) {
+        // Asked for by something else; the ticket in use is still good.
+        return;
+    }
+    debugMessage(QString("[profiles] Could not get a new ticket: %1").arg(error));
+    QStringList failed = queued;
+    queued.clear();
+    foreach (QString key, failed) {
+        retried.remove(key);
+        emit profileFailed(key, error);
+    }
 }
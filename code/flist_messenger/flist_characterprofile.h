@@ -2,17 +2,85 @@
 #define FCHARACTERPROFILE_H
 
 #include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QHash>
+#include <QSet>
+#include <QCache>
 
-class FCharacterProfile : public QObject
-{
-Q_OBJECT
-public:
-    explicit FCharacterProfile(QObject *parent = 0);
+#include "flist_api.h"
 
-signals:
+class FAccount;
 
-public slots:
+// A character's profile, resolved into display form.
+class FCharacterProfileData {
+    public:
+        bool isNull() const { return fetched == 0; }
 
+        QList<QPair<QString, QString>> info;        //< Infotags as (name, value), in display order.
+        QList<QPair<QString, QString>> customkinks; //< Custom kinks as (name, description).
+        qint64 fetched = 0;                         //< When it came from the server, in milliseconds since the epoch.
+};
+
+// Process wide store for character profiles, fetched over the JSON API
+// rather than through a chat session.
+//
+// Profiles are kept in a small LRU in memory and under "<cachedir>/profiles/"
+// on disk, so a profile that was viewed before is available immediately.
+// Once older than the TTL a profile is still returned but refreshed in the
+// background. Requests are queued and coalesced: asking again for a profile
+// already on its way does nothing, and at most MaxRequests go out at once.
+// The API has no multi-character call, so this is as far as batching goes.
+// A request refused for an expired ticket is queued again and retried once
+// the account has fetched a new ticket.
+class FCharacterProfile : public QObject {
+        Q_OBJECT
+    public:
+        static const int MaxRequests = 2;
+
+        explicit FCharacterProfile(QString cachedir, int ttlhours, int maxentries, QObject *parent = nullptr);
+
+        // Fetches need a ticket. Set again whenever the account gets a new one.
+        void setTicket(FAccount *account, QString ticket);
+
+        // The profile if it's in memory or on disk, otherwise a null profile. Stale profiles are refreshed in the background.
+        FCharacterProfileData profile(QString name);
+        // Fetch 'name' from the server. profileReady() or profileFailed() follows.
+        void request(QString name);
+
+    signals:
+        void profileReady(QString name);
+        void profileFailed(QString name, QString error);
+
+    private slots:
+        void mappingFinished();
+        void mappingFailed(QString error_id, QString error_message);
+        void characterFinished();
+        void characterFailed(QString error_id, QString error_message);
+        void ticketFailed(FAccount *source, QString error);
+
+    private:
+        QString cachePath(QString key);
+        FCharacterProfileData load(QString key);
+        void save(QString key, const FCharacterProfileData &profile);
+        FCharacterProfileData resolve(const FHttpApi::CharacterData &data);
+        void pump();
+
+        QString cachedir;
+        qint64 ttl; //< Milliseconds.
+        FAccount *account = nullptr; //< Asked for a new ticket when the current one is refused.
+        FHttpApi::Ticket ticket;
+        QCache<QString, FCharacterProfileData> memory; //< By lower case name.
+
+        QStringList queued;                             //< Lower case names waiting for a free request slot.
+        QHash<FHttpApi::BaseRequest *, QString> running; //< Requests on their way, with the name they are for.
+        QSet<QString> retried;                           //< Names already requeued once for a refused ticket.
+
+        FHttpApi::MappingList mapping;
+        bool mappingready = false;
+        FHttpApi::Request<FHttpApi::MappingList> *mappingrequest = nullptr;
 };
 
 #endif // FCHARACTERPROFILE_H
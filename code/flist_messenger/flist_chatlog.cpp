@@ -0,0 +1,804 @@
+#include "flist_chatlog.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTimer>
+#include <QDirIterator>
+#include <QRegularExpression>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+
+#include "flist_global.h"
+
+const char FChatLog::LogMagic[4] = {'F', 'L', 'O', 'G'};
+const char FChatLog::IndexMagic[4] = {'F', 'I', 'D', 'X'};
+const char FChatLog::CompressedMagic[4] = {'F', 'L', 'G', 'Z'};
+
+static QByteArray makeHeader(const char *magic) {
+    QByteArray header(magic, 4);
+    char version[4];
+    qToBigEndian<quint32>(FChatLog::Version, version);
+    header.append(version, 4);
+    return header;
+}
+
+static bool checkHeader(const QByteArray &header, const char *magic) {
+    return header.size() == FChatLog::HeaderSize && header.startsWith(QByteArray(magic, 4)) && qFromBigEndian<quint32>(header.constData() + 4) == FChatLog::Version;
+}
+
+QByteArray FChatLogRecord::serialize() const {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << timestamp << session << panel << sender << (qint32)type << bbcode << html;
+    return payload;
+}
+
+bool FChatLogRecord::deserialize(const QByteArray &payload) {
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint32 rawtype;
+    stream >> timestamp >> session >> panel >> sender >> rawtype >> bbcode >> html;
+    type = (MessageType)rawtype;
+    return stream.status() == QDataStream::Ok;
+}
+
+FChatLogReader::FChatLogReader(QString filename, bool prefercompressed)
+    : filename(filename), file(filename), indexloaded(false), prefercompressed(prefercompressed), mapped(0), mappedsize(0), compressed(false), logicalsize(0), blockoffsets(), cachedblock(-1), cacheddata() {}
+
+FChatLogReader::~FChatLogReader() {
+    close();
+}
+
+bool FChatLogReader::open() {
+    if (file.isOpen()) {
+        return true;
+    }
+    QString compressedname = FChatLog::compressedFileName(filename);
+    compressed = QFile::exists(compressedname) && (prefercompressed || !QFile::exists(filename));
+    file.setFileName(compressed ? compressedname : filename);
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    if (compressed && !openCompressed()) {
+        debugMessage(QString("The compressed chat log '%1' is damaged.").arg(compressedname));
+        file.close();
+        return false;
+    }
+    if (!compressed && file.size() > 0) {
+        mappedsize = file.size();
+        mapped = file.map(0, mappedsize);
+    }
+    QByteArray header;
+    if (!readBytes(0, FChatLog::HeaderSize, header) || !checkHeader(header, FChatLog::LogMagic)) {
+        debugMessage(QString("The chat log '%1' has an unrecognised header.").arg(filename));
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool FChatLogReader::openCompressed() {
+    // Layout: header, blocks, block table, offset of the block table.
+    if (!checkHeader(file.read(FChatLog::HeaderSize), FChatLog::CompressedMagic) || file.size() < FChatLog::HeaderSize + 8) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint64 table;
+    file.seek(file.size() - 8);
+    stream >> table;
+    if (table < FChatLog::HeaderSize || !file.seek(table)) {
+        return false;
+    }
+    quint32 count;
+    stream >> logicalsize >> count;
+    blockoffsets.resize(count + 1);
+    for (quint32 i = 0; i <= count; i++) {
+        stream >> blockoffsets[i];
+    }
+    return stream.status() == QDataStream::Ok && (qint64)count == (logicalsize + FChatLog::BlockSize - 1) / FChatLog::BlockSize;
+}
+
+void FChatLogReader::close() {
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = 0;
+    }
+    file.close();
+    cachedblock = -1;
+    cacheddata.clear();
+}
+
+qint64 FChatLogReader::size() {
+    if (compressed) {
+        return logicalsize;
+    }
+    return mapped ? mappedsize : file.size();
+}
+
+bool FChatLogReader::loadBlock(int block) {
+    if (block == cachedblock) {
+        return true;
+    }
+    if (block < 0 || block + 1 >= blockoffsets.count() || !file.seek(blockoffsets[block])) {
+        return false;
+    }
+    cacheddata = qUncompress(file.read(blockoffsets[block + 1] - blockoffsets[block]));
+    if (cacheddata.isEmpty()) {
+        cachedblock = -1;
+        return false;
+    }
+    cachedblock = block;
+    return true;
+}
+
+qint64 FChatLogReader::firstOffset() {
+    return FChatLog::HeaderSize;
+}
+
+bool FChatLogReader::readBytes(qint64 offset, qint64 length, QByteArray &out) {
+    if (offset < 0 || length < 0 || offset + length > size()) {
+        return false;
+    }
+    if (mapped) {
+        out = QByteArray((const char *)mapped + offset, length);
+        return true;
+    }
+    if (!compressed) {
+        if (!file.seek(offset)) {
+            return false;
+        }
+        out = file.read(length);
+        return out.size() == length;
+    }
+    // Only the blocks covering the requested range are decompressed; the most recent one is kept for the next read.
+    out.clear();
+    out.reserve(length);
+    while (length > 0) {
+        if (!loadBlock(offset / FChatLog::BlockSize)) {
+            return false;
+        }
+        qint64 start = offset % FChatLog::BlockSize;
+        qint64 chunk = qMin(length, (qint64)cacheddata.size() - start);
+        if (chunk <= 0) {
+            return false;
+        }
+        out.append(cacheddata.constData() + start, chunk);
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool FChatLogReader::readNext(qint64 &offset, FChatLogRecord &record) {
+    QByteArray lengthbytes;
+    if (!readBytes(offset, 4, lengthbytes)) {
+        return false;
+    }
+    qint64 length = qFromBigEndian<quint32>(lengthbytes.constData());
+    QByteArray frame;
+    if (!readBytes(offset + 4, length + 4, frame)) {
+        return false;
+    }
+    if (qFromBigEndian<quint32>(frame.constData() + length) != length) {
+        return false;
+    }
+    frame.truncate(length);
+    if (!record.deserialize(frame)) {
+        return false;
+    }
+    offset += length + 8;
+    return true;
+}
+
+bool FChatLogReader::readPrevious(qint64 &offset, FChatLogRecord &record) {
+    QByteArray lengthbytes;
+    if (offset - 8 < firstOffset() || !readBytes(offset - 4, 4, lengthbytes)) {
+        return false;
+    }
+    qint64 length = qFromBigEndian<quint32>(lengthbytes.constData());
+    qint64 start = offset - 8 - length;
+    if (start < firstOffset()) {
+        return false;
+    }
+    qint64 next = start;
+    if (!readNext(next, record) || next != offset) {
+        return false;
+    }
+    offset = start;
+    return true;
+}
+
+void FChatLogReader::loadIndex() {
+    if (indexloaded) {
+        return;
+    }
+    indexloaded = true;
+    QFile indexfile(FChatLog::indexFileName(filename));
+    if (!indexfile.open(QFile::ReadOnly)) {
+        return;
+    }
+    if (!checkHeader(indexfile.read(FChatLog::HeaderSize), FChatLog::IndexMagic)) {
+        return;
+    }
+    QByteArray entries = indexfile.readAll();
+    const char *p = entries.constData();
+    int count = entries.size() / 16;
+    index.reserve(count);
+    for (int i = 0; i < count; i++, p += 16) {
+        FChatLogIndexEntry entry;
+        entry.timestamp = qFromBigEndian<qint64>(p);
+        entry.offset = qFromBigEndian<qint64>(p + 8);
+        index.append(entry);
+    }
+}
+
+qint64 FChatLogReader::seekTime(qint64 timestamp) {
+    loadIndex();
+    // Entries strictly older than 'timestamp' only have older records before them, so they are safe to skip to.
+    auto it = std::lower_bound(index.cbegin(), index.cend(), timestamp, [](const FChatLogIndexEntry &entry, qint64 t) { return entry.timestamp < t; });
+    while (it != index.cbegin()) {
+        --it;
+        if (it->offset >= firstOffset() && it->offset < size()) {
+            return it->offset;
+        }
+    }
+    return firstOffset();
+}
+
+FChatLog::FChatLog(QString logroot, QObject *parent) : QObject(parent), logroot(logroot), lastindexed() {
+    qRegisterMetaType<FChatLogRecord>("FChatLogRecord");
+}
+
+QString FChatLog::baseName(QString sessioncharacter, FChannel::ChannelType type, QString name, QString title) {
+    QString logName, dirName;
+
+    if (!sessioncharacter.isEmpty()) {
+        logName = escapeFileName(sessioncharacter) + "~";
+    }
+
+    switch (type) {
+        case FChannel::CHANTYPE_NORMAL:
+            dirName += "public";
+            logName += escapeFileName(name);
+            break;
+        case FChannel::CHANTYPE_ADHOC:
+            dirName += "private";
+            logName += QString("%1~%2").arg(escapeFileName(name), escapeFileName(title));
+            break;
+
+        case FChannel::CHANTYPE_PM:
+            dirName += "pm";
+            logName += escapeFileName(name);
+            break;
+
+        case FChannel::CHANTYPE_CONSOLE:
+            dirName += "console";
+            logName += escapeFileName(name);
+            break;
+        default:
+            logName += escapeFileName(name);
+            break;
+    }
+    if (dirName.isEmpty()) {
+        return logName;
+    }
+    return dirName + "/" + logName;
+}
+
+QString FChatLog::fileName(QString basename, QDate day) {
+    return QString("%1/%2~%3.flog").arg(logroot, basename, day.toString("yyyy-MM-dd"));
+}
+
+QString FChatLog::indexFileName(QString logfile) {
+    return logfile.left(logfile.length() - 5) + ".fidx";
+}
+
+QString FChatLog::compressedFileName(QString logfile) {
+    return logfile + "z";
+}
+
+qint64 FChatLog::logicalSize(QString logfile) {
+    QFileInfo plain(logfile);
+    if (plain.exists()) {
+        return plain.size();
+    }
+    // Compressed layout: header, blocks, [logical size][block count][block offsets], offset of that table.
+    QFile file(compressedFileName(logfile));
+    if (!file.open(QFile::ReadOnly) || file.size() < HeaderSize + 8) {
+        return -1;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint64 table;
+    qint64 size;
+    file.seek(file.size() - 8);
+    stream >> table;
+    if (table < HeaderSize || !file.seek(table)) {
+        return -1;
+    }
+    stream >> size;
+    return stream.status() == QDataStream::Ok ? size : -1;
+}
+
+bool FChatLog::compressFile(QString logfile) {
+    QString compressedname = compressedFileName(logfile);
+    QFile in(logfile);
+    if (!in.open(QFile::ReadOnly)) {
+        return false;
+    }
+    if (!QFile::exists(compressedname)) {
+        QSaveFile out(compressedname);
+        if (!out.open(QFile::WriteOnly)) {
+            debugMessage(QString("Could not write the compressed chat log '%1': %2").arg(compressedname, out.errorString()));
+            return false;
+        }
+        out.write(makeHeader(CompressedMagic));
+        QVector<qint64> blockoffsets;
+        while (!in.atEnd()) {
+            blockoffsets.append(out.pos());
+            out.write(qCompress(in.read(BlockSize)));
+        }
+        blockoffsets.append(out.pos());
+        qint64 table = out.pos();
+        QDataStream stream(&out);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << in.size() << (quint32)(blockoffsets.count() - 1);
+        foreach (qint64 offset, blockoffsets) {
+            stream << offset;
+        }
+        stream << table;
+        if (!out.commit()) {
+            debugMessage(QString("Could not write the compressed chat log '%1': %2").arg(compressedname, out.errorString()));
+            return false;
+        }
+    }
+    in.close();
+
+    // Only drop the original once the compressed copy reads back to the same place. A reader holding the
+    // original open can make the removal fail, in which case the next pass tries again.
+    qint64 ends[2] = {-1, -1};
+    for (int i = 0; i < 2; i++) {
+        FChatLogReader reader(logfile, i == 1);
+        if (!reader.open()) {
+            break;
+        }
+        FChatLogRecord record;
+        ends[i] = reader.firstOffset();
+        while (reader.readNext(ends[i], record)) {
+        }
+    }
+    if (ends[0] < 0 || ends[0] != ends[1]) {
+        debugMessage(QString("The compressed copy of '%1' did not verify, keeping the original.").arg(logfile));
+        QFile::remove(compressedname);
+        return false;
+    }
+    return QFile::remove(logfile);
+}
+
+// Cut the sparse index of 'logfile' back to whole entries pointing before 'end', where the log now stops.
+static void trimIndex(const QString &logfile, qint64 end) {
+    QFile indexfile(FChatLog::indexFileName(logfile));
+    if (!indexfile.exists() || !indexfile.open(QFile::ReadWrite)) {
+        return;
+    }
+    qint64 keep = 0;
+    if (checkHeader(indexfile.read(FChatLog::HeaderSize), FChatLog::IndexMagic)) {
+        keep = FChatLog::HeaderSize;
+        QByteArray entries = indexfile.readAll();
+        for (int i = 0; i + 16 <= entries.size() && qFromBigEndian<qint64>(entries.constData() + i + 8) < end; i += 16) {
+            keep += 16;
+        }
+    }
+    if (keep < indexfile.size()) {
+        debugMessage(QString("Truncating %1 bytes from the end of the chat log index '%2'.").arg(indexfile.size() - keep).arg(indexfile.fileName()));
+        indexfile.resize(keep);
+    }
+}
+
+qint64 FChatLog::recoverTail(QString logfile) {
+    // A crash part way through a write leaves a torn frame at the end of the file, and maybe a torn or dangling index entry.
+    // Drop them so later appends stay reachable.
+    QFile file(logfile);
+    if (!file.exists() || file.size() == 0) {
+        trimIndex(logfile, 0);
+        return 0;
+    }
+    FChatLogReader reader(logfile);
+    if (!reader.open()) {
+        if (file.size() < HeaderSize) {
+            file.resize(0);
+            trimIndex(logfile, 0);
+            return 0;
+        }
+        return -1;
+    }
+    qint64 offset = reader.seekTime(std::numeric_limits<qint64>::max());
+    FChatLogRecord record;
+    while (reader.readNext(offset, record)) {
+    }
+    qint64 size = reader.size();
+    reader.close();
+    if (offset < size) {
+        debugMessage(QString("Truncating %1 damaged bytes from the end of the chat log '%2'.").arg(size - offset).arg(logfile));
+        file.resize(offset);
+    }
+    trimIndex(logfile, offset);
+    return offset;
+}
+
+/**
+Repair the end of the newest day of every log, the only one a crash can have left part way through a write. Call this before the log
+thread starts: a reader there may map a day, and cutting a mapped file short would pull the pages out from under it.
+ */
+void FChatLog::recover() {
+    // "<base>~yyyy-MM-dd.flog"; the ISO dates sort by name.
+    static const int DaySuffixLength = 16;
+    QHash<QString, QString> newest;
+    QDirIterator it(logroot, QStringList() << "*.flog", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString logfile = it.next();
+        if (logfile.length() <= DaySuffixLength) {
+            continue;
+        }
+        QString basename = logfile.left(logfile.length() - DaySuffixLength);
+        if (logfile > newest.value(basename)) {
+            newest[basename] = logfile;
+        }
+    }
+    foreach (const QString &logfile, newest) {
+        if (recoverTail(logfile) >= 0) {
+            lastIndexedOffset(logfile);
+        }
+    }
+}
+
+qint64 FChatLog::lastIndexedOffset(QString logfile) {
+    if (lastindexed.contains(logfile)) {
+        return lastindexed.value(logfile);
+    }
+    qint64 last = -1;
+    QFile indexfile(indexFileName(logfile));
+    if (indexfile.open(QFile::ReadOnly) && indexfile.size() >= HeaderSize + 16) {
+        indexfile.seek(HeaderSize + ((indexfile.size() - HeaderSize) / 16 - 1) * 16 + 8);
+        QByteArray entry = indexfile.read(8);
+        if (entry.size() == 8) {
+            last = qFromBigEndian<qint64>(entry.constData());
+        }
+    }
+    lastindexed[logfile] = last;
+    return last;
+}
+
+bool FChatLog::append(QString basename, const FChatLogRecord &record) {
+    QString logfile = fileName(basename, QDateTime::fromMSecsSinceEpoch(record.timestamp).date());
+    QString dirname = QFileInfo(logfile).path();
+    if (!QDir().exists(dirname)) {
+        QDir().mkpath(dirname);
+    }
+    if (!lastindexed.contains(logfile)) {
+        if (recoverTail(logfile) < 0) {
+            debugMessage(QString("Not appending to '%1' as it is not a chat log.").arg(logfile));
+            return false;
+        }
+        lastIndexedOffset(logfile);
+    }
+
+    QFile file(logfile);
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        debugMessage(QString("Could not open the chat log '%1' for writing: %2").arg(logfile, file.errorString()));
+        return false;
+    }
+    qint64 offset = file.size();
+    if (offset == 0) {
+        file.write(makeHeader(LogMagic));
+        offset = HeaderSize;
+    }
+    QByteArray payload = record.serialize();
+    char length[4];
+    qToBigEndian<quint32>(payload.size(), length);
+    QByteArray frame;
+    frame.reserve(payload.size() + 8);
+    frame.append(length, 4);
+    frame.append(payload);
+    frame.append(length, 4);
+    if (file.write(frame) != frame.size()) {
+        debugMessage(QString("Failed to write to the chat log '%1': %2").arg(logfile, file.errorString()));
+        return false;
+    }
+    file.close();
+
+    qint64 last = lastindexed.value(logfile, -1);
+    if (last < 0 || offset - last >= IndexInterval) {
+        QFile indexfile(indexFileName(logfile));
+        if (indexfile.open(QFile::WriteOnly | QFile::Append)) {
+            if (indexfile.size() == 0) {
+                indexfile.write(makeHeader(IndexMagic));
+            }
+            char entry[16];
+            qToBigEndian<qint64>(record.timestamp, entry);
+            qToBigEndian<qint64>(offset, entry + 8);
+            indexfile.write(entry, 16);
+            lastindexed[logfile] = offset;
+        }
+    }
+
+    emit recordAppended(logfile, offset, offset + frame.size(), record);
+    return true;
+}
+
+QList<QDate> FChatLog::days(QString basename) {
+    QList<QDate> rv;
+    QFileInfo info(QString("%1/%2").arg(logroot, basename));
+    QString prefix = info.fileName() + "~";
+    QStringList files = info.dir().entryList(QStringList() << prefix + "*.flog" << prefix + "*.flogz", QDir::Files);
+    foreach (QString name, files) {
+        QString suffix = name.mid(prefix.length() + 10);
+        QDate day = QDate::fromString(name.mid(prefix.length(), 10), "yyyy-MM-dd");
+        if (day.isValid() && (suffix == ".flog" || suffix == ".flogz") && !rv.contains(day)) {
+            rv.append(day);
+        }
+    }
+    std::sort(rv.begin(), rv.end());
+    return rv;
+}
+
+QList<FChatLogRecord> FChatLog::readRange(QString basename, QDateTime from, QDateTime to, int limit) {
+    QList<FChatLogRecord> rv;
+    qint64 fromms = from.toMSecsSinceEpoch();
+    qint64 toms = to.toMSecsSinceEpoch();
+    foreach (QDate day, days(basename)) {
+        if (day < from.date() || day > to.date()) {
+            continue;
+        }
+        FChatLogReader reader(fileName(basename, day));
+        if (!reader.open()) {
+            continue;
+        }
+        qint64 offset = reader.seekTime(fromms);
+        FChatLogRecord record;
+        while (reader.readNext(offset, record)) {
+            if (record.timestamp > toms) {
+                break;
+            }
+            if (record.timestamp >= fromms) {
+                rv.append(record);
+                if (limit > 0 && rv.count() >= limit) {
+                    return rv;
+                }
+            }
+        }
+    }
+    return rv;
+}
+
+QList<FChatLogRecord> FChatLog::readLast(QString basename, int count, qint64 before) {
+    QList<FChatLogRecord> rv;
+    QList<QDate> daylist = days(basename);
+    QDate lastday = before == std::numeric_limits<qint64>::max() ? QDate() : QDateTime::fromMSecsSinceEpoch(before).date();
+    for (int i = daylist.count() - 1; i >= 0 && rv.count() < count; i--) {
+        if (lastday.isValid() && daylist[i] > lastday) {
+            continue;
+        }
+        FChatLogReader reader(fileName(basename, daylist[i]));
+        if (!reader.open()) {
+            continue;
+        }
+        QList<FChatLogRecord> daylines;
+        qint64 offset = reader.size();
+        FChatLogRecord record;
+        while (rv.count() + daylines.count() < count && reader.readPrevious(offset, record)) {
+            if (record.timestamp < before) {
+                daylines.prepend(record);
+            }
+        }
+        rv = daylines + rv;
+    }
+    return rv;
+}
+
+bool FChatLog::exportHtml(QString logfile, QString htmlfile) {
+    FChatLogReader reader(logfile);
+    if (!reader.open()) {
+        return false;
+    }
+    QString dirname = QFileInfo(htmlfile).path();
+    if (!QDir().exists(dirname)) {
+        QDir().mkpath(dirname);
+    }
+    QFile out(htmlfile);
+    if (!out.open(QFile::WriteOnly | QFile::Truncate)) {
+        debugMessage(QString("Could not open '%1' for writing: %2").arg(htmlfile, out.errorString()));
+        return false;
+    }
+    qint64 offset = reader.firstOffset();
+    FChatLogRecord record;
+    while (reader.readNext(offset, record)) {
+        out.write((record.html + "<br />\n").toUtf8());
+    }
+    return true;
+}
+
+/**
+Convert a per-day HTML log written by older versions into a structured log at 'logfile'. Each "<br />" terminated line becomes one record; its time comes from the "<small>[hh:mm:ss AP]</small>" prefix, or from the line before it if there is none. 'logfile' must not exist yet.
+ */
+bool FChatLog::importHtml(QString htmlfile, QString logfile) {
+    QString name = QFileInfo(htmlfile).fileName();
+    QDate day = QDate::fromString(name.mid(name.length() - 15, 10), "yyyy-MM-dd");
+    QFile in(htmlfile);
+    if (!day.isValid() || !in.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QSaveFile out(logfile);
+    QFile indexfile(indexFileName(logfile));
+    if (!out.open(QFile::WriteOnly) || !indexfile.open(QFile::WriteOnly | QFile::Truncate)) {
+        debugMessage(QString("Could not write the chat log '%1' imported from '%2'.").arg(logfile, htmlfile));
+        return false;
+    }
+    out.write(makeHeader(LogMagic));
+    indexfile.write(makeHeader(IndexMagic));
+
+    static const QByteArray separator("<br />\n");
+    static const QRegularExpression timestamp("^<small>\\[(\\d\\d:\\d\\d:\\d\\d [AP]M)\\]</small>");
+    qint64 offset = HeaderSize;
+    qint64 indexed = -1;
+    FChatLogRecord record;
+    record.type = MESSAGE_TYPE_CHAT;
+    record.timestamp = QDateTime(day, QTime(0, 0)).toMSecsSinceEpoch();
+    QByteArray line;
+    while (!in.atEnd()) {
+        line += in.readLine();
+        if (!line.endsWith(separator) && !in.atEnd()) {
+            // A message with a line break of its own; the entry only ends at the separator.
+            continue;
+        }
+        if (line.endsWith(separator)) {
+            line.chop(separator.size());
+        }
+        record.html = QString::fromUtf8(line);
+        line.clear();
+        QRegularExpressionMatch match = timestamp.match(record.html);
+        if (match.hasMatch()) {
+            QTime time = QTime::fromString(match.captured(1), "hh:mm:ss AP");
+            if (time.isValid()) {
+                record.timestamp = QDateTime(day, time).toMSecsSinceEpoch();
+            }
+        }
+        QByteArray payload = record.serialize();
+        char length[4];
+        qToBigEndian<quint32>(payload.size(), length);
+        out.write(length, 4);
+        out.write(payload);
+        out.write(length, 4);
+        if (indexed < 0 || offset - indexed >= IndexInterval) {
+            char entry[16];
+            qToBigEndian<qint64>(record.timestamp, entry);
+            qToBigEndian<qint64>(offset, entry + 8);
+            indexfile.write(entry, 16);
+            indexed = offset;
+        }
+        offset += payload.size() + 8;
+    }
+    indexfile.close();
+    if (!out.commit()) {
+        debugMessage(QString("Could not write the chat log '%1' imported from '%2': %3").arg(logfile, htmlfile, out.errorString()));
+        QFile::remove(indexfile.fileName());
+        return false;
+    }
+    return true;
+}
+
+FChatLogCompressor::FChatLogCompressor(QString logroot, int afterdays, QObject *parent) : QObject(parent), logroot(logroot), afterdays(afterdays) {}
+
+void FChatLogCompressor::start() {
+    QTimer *timer = new QTimer(this);
+    connect(timer, SIGNAL(timeout()), this, SLOT(compressOldLogs()));
+    timer->start(Interval);
+    // Stay off the disk while the client is still starting up.
+    QTimer::singleShot(60000, this, SLOT(compressOldLogs()));
+}
+
+void FChatLogCompressor::compressOldLogs() {
+    QStringList candidates;
+    // Per-day HTML logs from older versions are converted whatever their age. Those versions wrote to "logs" in the
+    // working directory, which is usually but not always the log root.
+    QStringList legacyroots;
+    legacyroots << logroot;
+    QString workinglogs = QDir::current().absoluteFilePath("logs");
+    if (QDir(workinglogs) != QDir(logroot)) {
+        legacyroots << workinglogs;
+    }
+    // Only names the old logger could have written are touched: "[<dir>/]<name>~yyyy-MM-dd.html".
+    static const QRegularExpression legacyname("^((public|private|pm|console)/)?[^/]+~\\d{4}-\\d{2}-\\d{2}\\.html$");
+    foreach (QString legacyroot, legacyroots) {
+        QDirIterator html(legacyroot, QStringList() << "*.html", QDir::Files, QDirIterator::Subdirectories);
+        while (html.hasNext()) {
+            QString htmlfile = html.next();
+            QString relative = QDir(legacyroot).relativeFilePath(htmlfile);
+            if (legacyname.match(relative).hasMatch() && !skipped.contains(htmlfile)) {
+                legacytargets[htmlfile] = logroot + "/" + relative.left(relative.length() - 5) + ".flog";
+                candidates.append(htmlfile);
+            }
+        }
+    }
+    if (afterdays > 0) {
+        QDirIterator it(logroot, QStringList() << "*.flog", QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString logfile = it.next();
+            if (isOld(it.fileName())) {
+                candidates.append(logfile);
+            }
+        }
+    }
+    bool idle = pending.isEmpty();
+    foreach (QString logfile, candidates) {
+        if (!pending.contains(logfile)) {
+            pending.append(logfile);
+        }
+    }
+    if (idle && !pending.isEmpty()) {
+        QMetaObject::invokeMethod(this, "compressPending", Qt::QueuedConnection);
+    }
+}
+
+void FChatLogCompressor::compressPending() {
+    // One file per pass so that scrollback reads queued on the same thread are not held up behind the whole backlog.
+    if (pending.isEmpty()) {
+        return;
+    }
+    QString file = pending.takeFirst();
+    if (file.endsWith(".html")) {
+        importLegacy(file);
+    } else {
+        FChatLog::compressFile(file);
+    }
+    if (!pending.isEmpty()) {
+        QMetaObject::invokeMethod(this, "compressPending", Qt::QueuedConnection);
+    }
+}
+
+bool FChatLogCompressor::isOld(QString filename) {
+    if (afterdays <= 0) {
+        return false;
+    }
+    QString name = QFileInfo(filename).fileName();
+    QDate day = QDate::fromString(name.mid(name.lastIndexOf('~') + 1, 10), "yyyy-MM-dd");
+    return day.isValid() && day < QDate::currentDate().addDays(-afterdays);
+}
+
+/**
+Replace a legacy HTML day with a structured one, compressed straight away if it is old enough. A day that already has a structured log is left alone: the two overlap on the day the client was upgraded, and the structured one is complete from there on.
+ */
+void FChatLogCompressor::importLegacy(QString htmlfile) {
+    QString logfile = legacytargets.take(htmlfile);
+    if (logfile.isEmpty()) {
+        return;
+    }
+    QDir().mkpath(QFileInfo(logfile).path());
+    if (QFile::exists(logfile) || QFile::exists(FChatLog::compressedFileName(logfile))) {
+        debugMessage(QString("Keeping the HTML log '%1', the day already has a structured log.").arg(htmlfile));
+        skipped.insert(htmlfile);
+        return;
+    }
+    if (!FChatLog::importHtml(htmlfile, logfile)) {
+        skipped.insert(htmlfile);
+        return;
+    }
+    QFile::remove(htmlfile);
+    if (isOld(logfile)) {
+        FChatLog::compressFile(logfile);
+    }
+    emit imported(logfile);
+}
+
+FChatLogScrollbackLoader::FChatLogScrollbackLoader(QString logroot, QObject *parent) : QObject(parent), log(new FChatLog(logroot, this)) {
+    qRegisterMetaType<QList<FChatLogRecord>>("QList<FChatLogRecord>");
+}
+
+void FChatLogScrollbackLoader::load(QString panelname, QString basename, int count, qint64 before) {
+    emit loaded(panelname, log->readLast(basename, count, before));
+}
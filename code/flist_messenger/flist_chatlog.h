@@ -0,0 +1,211 @@
+#ifndef FLIST_CHATLOG_H
+#define FLIST_CHATLOG_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+#include <QMetaType>
+#include <QVector>
+#include <limits>
+
+#include "flist_enums.h"
+#include "flist_channel.h"
+
+// A single line of chat history as stored in the structured log.
+class FChatLogRecord {
+    public:
+        FChatLogRecord() : timestamp(0), type(MESSAGE_TYPE_SYSTEM) {}
+
+        QByteArray serialize() const;
+        bool deserialize(const QByteArray &payload);
+
+        qint64 timestamp; //< Milliseconds since the epoch.
+        QString session;  //< Character the session was logged in as.
+        QString panel;    //< Panel the line was displayed on.
+        QString sender;   //< Character that sent the line, empty for client generated lines.
+        MessageType type;
+        QString bbcode; //< Raw BBCode as sent or received, if known.
+        QString html;   //< Rendered HTML as displayed.
+};
+
+Q_DECLARE_METATYPE(FChatLogRecord)
+
+class FChatLogIndexEntry {
+    public:
+        qint64 timestamp;
+        qint64 offset;
+};
+
+// Sequential and random access to a single day's structured log file.
+//
+// A log file is a short header followed by frames of the form
+// [length][payload][length]. The trailing length allows the file to be
+// walked backwards from the end without an index.
+//
+// If only the compressed "<name>.flogz" form of a day exists it is read
+// instead. Offsets are always those of the uncompressed file, so the time
+// index and search postings stay valid after compression.
+class FChatLogReader {
+    public:
+        explicit FChatLogReader(QString filename, bool prefercompressed = false);
+        ~FChatLogReader();
+
+        bool open();
+        void close();
+        bool isOpen() { return file.isOpen(); }
+        bool isCompressed() { return compressed; }
+
+        QString getFileName() { return filename; }
+
+        // Offset one past the last readable byte.
+        qint64 size();
+        qint64 firstOffset();
+
+        // Read the record starting at 'offset' and advance 'offset' to the following record.
+        bool readNext(qint64 &offset, FChatLogRecord &record);
+        // Read the record ending at 'offset' and move 'offset' back to the start of that record.
+        bool readPrevious(qint64 &offset, FChatLogRecord &record);
+        // Find an offset at or before the first record with a timestamp not less than 'timestamp', using the sparse index.
+        qint64 seekTime(qint64 timestamp);
+
+    private:
+        bool openCompressed();
+        bool readBytes(qint64 offset, qint64 length, QByteArray &out);
+        bool loadBlock(int block);
+        void loadIndex();
+
+        QString filename;
+        QFile file;
+        bool indexloaded;
+        QList<FChatLogIndexEntry> index;
+
+        bool prefercompressed;
+        uchar *mapped; //< Plain files are memory mapped where possible.
+        qint64 mappedsize;
+        bool compressed;
+        qint64 logicalsize;
+        QVector<qint64> blockoffsets; //< Where each compressed block starts, plus one entry for the end of the last block.
+        int cachedblock;
+        QByteArray cacheddata;
+};
+
+// Append-only structured chat log. This is the only log written; HTML for
+// a day is rendered from it on demand by exportHtml().
+//
+// Logs are addressed by a base name relative to the log root such as
+// "public/Character~Channel". Each day is stored in its own
+// "<base>~yyyy-MM-dd.flog" file with a sparse "<base>~yyyy-MM-dd.fidx" time
+// index holding an entry roughly every IndexInterval bytes. Older days may
+// have been compressed by FChatLogCompressor; FChatLogReader hides this.
+class FChatLog : public QObject {
+        Q_OBJECT
+    public:
+        static const quint32 Version = 1;
+        static const qint64 HeaderSize = 8;
+        static const qint64 IndexInterval = 16384;
+        static const qint64 BlockSize = 65536;
+        static const char LogMagic[4];
+        static const char IndexMagic[4];
+        static const char CompressedMagic[4];
+
+        explicit FChatLog(QString logroot, QObject *parent = nullptr);
+
+        QString getLogRoot() { return logroot; }
+
+        QString fileName(QString basename, QDate day);
+        // Where a panel's logs go relative to the log root, without the date suffix.
+        static QString baseName(QString sessioncharacter, FChannel::ChannelType type, QString name, QString title);
+        static QString indexFileName(QString logfile);
+        static QString compressedFileName(QString logfile);
+        // Size of the uncompressed day, from the file size or a compressed day's trailer. -1 if there is no such day.
+        static qint64 logicalSize(QString logfile);
+
+        // Rewrite a finished day into the block compressed form and remove the original.
+        static bool compressFile(QString logfile);
+
+        // Trim what a crash left at the end of the logs. Must run before anything else opens them.
+        void recover();
+        bool append(QString basename, const FChatLogRecord &record);
+
+        // Days that have a structured log for 'basename', oldest first.
+        QList<QDate> days(QString basename);
+        // Records with a timestamp in [from, to], oldest first. A positive 'limit' stops after that many records.
+        QList<FChatLogRecord> readRange(QString basename, QDateTime from, QDateTime to, int limit = -1);
+        // The last 'count' records logged for 'basename' before 'before', oldest first.
+        QList<FChatLogRecord> readLast(QString basename, int count, qint64 before = std::numeric_limits<qint64>::max());
+
+        // Render a structured log file in the format of the old per-day HTML logs.
+        bool exportHtml(QString logfile, QString htmlfile);
+        // The reverse, for the per-day HTML logs older versions wrote.
+        static bool importHtml(QString htmlfile, QString logfile);
+
+    signals:
+        // 'next' is the offset just past the record, where the following one will start.
+        void recordAppended(QString logfile, qint64 offset, qint64 next, FChatLogRecord record);
+
+    private:
+        qint64 recoverTail(QString logfile);
+        qint64 lastIndexedOffset(QString logfile);
+
+        QString logroot;
+        QHash<QString, qint64> lastindexed; //< Log file -> offset of the newest sparse index entry.
+};
+
+// Periodically compresses structured logs older than a configurable number
+// of days, one file per queued call. Meant to live on a worker thread.
+//
+// The per-day HTML logs written by older versions are converted into
+// structured logs on the first pass, then compressed like any other day.
+class FChatLogCompressor : public QObject {
+        Q_OBJECT
+    public:
+        static const int Interval = 6 * 60 * 60 * 1000;
+
+        explicit FChatLogCompressor(QString logroot, int afterdays, QObject *parent = nullptr);
+
+    public slots:
+        void start();
+        void compressOldLogs();
+
+    signals:
+        // A legacy HTML day was converted into the structured log 'logfile'.
+        void imported(QString logfile);
+
+    private slots:
+        void compressPending();
+
+    private:
+        bool isOld(QString filename);
+        void importLegacy(QString htmlfile);
+
+        QString logroot;
+        int afterdays;
+        QStringList pending;  //< Log files still to be compressed, and HTML logs still to be converted.
+        QSet<QString> skipped; //< HTML logs that could not be converted, so they are not retried every pass.
+        QHash<QString, QString> legacytargets; //< HTML log -> structured log it is converted into.
+};
+
+// Reads the tail of a panel's history for scrollback. Meant to live on a
+// worker thread so the reads never block the interface.
+class FChatLogScrollbackLoader : public QObject {
+        Q_OBJECT
+    public:
+        explicit FChatLogScrollbackLoader(QString logroot, QObject *parent = nullptr);
+
+    public slots:
+        void load(QString panelname, QString basename, int count, qint64 before);
+
+    signals:
+        void loaded(QString panelname, QList<FChatLogRecord> records);
+
+    private:
+        FChatLog *log;
+};
+
+#endif // FLIST_CHATLOG_H
@@ -0,0 +1,17 @@
+#include "flist_escapes.h"
+
+bool is_broken_escaped_apos(std::string const &data, std::string::size_type n) {
+    return n + 2 <= data.size() and data[n] == '\\' and data[n + 1] == '\'';
+}
+
+void fix_broken_escaped_apos(std::string &data) {
+    // Compact in place in a single pass, rather than shifting the rest of the string down at every match.
+    std::string::size_type out = 0;
+    for (std::string::size_type n = 0; n < data.size(); ++n) {
+        if (is_broken_escaped_apos(data, n)) {
+            ++n;
+        }
+        data[out++] = data[n];
+    }
+    data.resize(out);
+}
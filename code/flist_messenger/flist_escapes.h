@@ -0,0 +1,11 @@
+#ifndef FLIST_ESCAPES_H
+#define FLIST_ESCAPES_H
+
+#include <string>
+
+// Whether 'data' holds a \' at 'n'. The server and older clients send these where a plain ' was meant.
+bool is_broken_escaped_apos(std::string const &data, std::string::size_type n);
+// Replace every \' in 'data' with '.
+void fix_broken_escaped_apos(std::string &data);
+
+#endif // FLIST_ESCAPES_H
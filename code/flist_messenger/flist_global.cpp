@@ -4,10 +4,15 @@
 #include <QSettings>
 #include <QByteArray>
 #include <QRegularExpression>
+#include <QFile>
 #include <iostream>
 #include "flist_parser.h"
 #include "api/endpoint_v1.h"
 #include "flist_settings.h"
+#include "flist_chatlog.h"
+#include "flist_imagecache.h"
+#include "flist_animationclock.h"
+#include "flist_characterprofile.h"
 #include <QWidget>
 #include <QWindow>
 
@@ -17,6 +22,10 @@ QString settingsfile;
 QString logpath;
 FSettings *settings = 0;
 FHttpApi::Endpoint *fapi = 0;
+FChatLog *chatlog = 0;
+FImageCache *imagecache = 0;
+FAnimationClock *animationclock = 0;
+FCharacterProfile *characterprofiles = 0;
 
 void debugMessage(QString str) {
     std::cout << str.toUtf8().data() << std::endl;
@@ -30,35 +39,32 @@ void debugMessage(const char *str) {
     std::cout << str << std::endl;
 }
 
-void globalInit() {
+void globalInit(bool headless) {
     // todo: parse command line for options
     // todo: make settingsfile configurable
-    settingsfile = qApp->applicationDirPath() + "/settings.ini";
+    // Not qApp: the headless logger runs on a plain QCoreApplication.
+    QCoreApplication *app = QCoreApplication::instance();
+    settingsfile = app->applicationDirPath() + "/settings.ini";
     // todo: make logpath configurable
-    logpath = qApp->applicationDirPath() + "/logs";
+    logpath = app->applicationDirPath() + "/logs";
 
-    networkaccessmanager = new QNetworkAccessManager(qApp);
+    networkaccessmanager = new QNetworkAccessManager(app);
     bbcodeparser = new BBCodeParser();
     fapi = new FHttpApi::Endpoint_v1(networkaccessmanager);
 
     // settings = new QSettings(settingsfile, QSettings::IniFormat);
-    settings = new FSettings(settingsfile, qApp);
+    settings = new FSettings(settingsfile, app);
+    chatlog = new FChatLog(logpath, app);
+    if (!headless) {
+        // Only needed to show images; both stay null when nothing is displayed.
+        imagecache = new FImageCache(networkaccessmanager, "cache", settings->getImageCacheTtlHours(), 32 * 1024 * 1024, app);
+        animationclock = new FAnimationClock(app);
+    }
+    characterprofiles = new FCharacterProfile("cache", settings->getProfileCacheTtlHours(), 200, app);
 }
 
 void globalQuit() {}
 
-bool is_broken_escaped_apos(std::string const &data, std::string::size_type n) {
-    return n + 2 <= data.size() and data[n] == '\\' and data[n + 1] == '\'';
-}
-
-void fix_broken_escaped_apos(std::string &data) {
-    for (std::string::size_type n = 0; n != data.size(); ++n) {
-        if (is_broken_escaped_apos(data, n)) {
-            data.replace(n, 2, 1, '\'');
-        }
-    }
-}
-
 QString escapeFileName(QString infilename) {
     QByteArray inname(infilename.toUtf8());
     QByteArray outname;
@@ -74,6 +80,21 @@ QString escapeFileName(QString infilename) {
     return QString::fromUtf8(outname);
 }
 
+qint64 residentBytes() {
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    while (!status.atEnd()) {
+        QByteArray line = status.readLine();
+        if (line.startsWith("VmRSS:")) {
+            // "VmRSS:     12345 kB"
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return -1;
+}
+
 QString htmlToPlainText(QString input) {
     QString output = input;
     static QRegularExpression regEx("<[^>]*>");
@@ -3,24 +3,33 @@
 
 #include <QNetworkAccessManager>
 #include "flist_api.h"
+#include "flist_escapes.h"
 
 class BBCodeParser;
 class FSettings;
+class FChatLog;
+class FImageCache;
+class FAnimationClock;
+class FCharacterProfile;
 
 extern QNetworkAccessManager *networkaccessmanager;
 extern BBCodeParser *bbcodeparser;
 extern FHttpApi::Endpoint *fapi;
 extern FSettings *settings;
+extern FChatLog *chatlog;
+extern FImageCache *imagecache;
+extern FAnimationClock *animationclock;
+extern FCharacterProfile *characterprofiles;
 
 void debugMessage(QString str);
 void debugMessage(std::string str);
 void debugMessage(const char *str);
-void globalInit();
+void globalInit(bool headless = false);
 void globalQuit();
-bool is_broken_escaped_apos(std::string const &data, std::string::size_type n);
-void fix_broken_escaped_apos(std::string &data);
 QString escapeFileName(QString infilename);
 QString htmlToPlainText(QString input);
+// Resident set size of the process in bytes, or -1 where it can't be read (only Linux is supported).
+qint64 residentBytes();
 
 // Centre a window on the screen it's mostly on. No idea what happens if
 // the window is not on any screen.
@@ -34,6 +43,8 @@ void centerOnScreen(QWidget *widge);
 #define FLIST_CLIENTID "F-List Desktop Client (Hoof Edition)"
 #define FLIST_BASEURL_REPORT "https://www.f-list.net/json/api/report-submit.php"
 #define FLIST_BASEURL_TICKET "https://www.f-list.net/json/getApiTicket.json"
+#define FLIST_BASEURL_CHARACTERDATA "https://www.f-list.net/json/api/character-data.php"
+#define FLIST_BASEURL_MAPPINGLIST "https://www.f-list.net/json/api/mapping-list.php"
 
 #define FLIST_CHAT_SERVER "wss://chat.f-list.net/chat2"
 // #define FLIST_CHAT_SERVER_PORT ":8722/" // Test server
@@ -0,0 +1,343 @@
+#include "flist_headless.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#    include <signal.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+#include "flist_global.h"
+#include "flist_settings.h"
+#include "flist_server.h"
+#include "flist_account.h"
+#include "flist_session.h"
+#include "flist_chatlog.h"
+#include "flist_panelregistry.h"
+
+#ifdef Q_OS_UNIX
+// Signal handlers can't touch Qt, so SIGUSR1 only writes a byte here and the event loop picks it up.
+static int signalfds[2] = {-1, -1};
+
+static void usr1Handler(int) {
+    char c = 1;
+    ssize_t written = ::write(signalfds[0], &c, sizeof(c));
+    (void)written;
+}
+#endif
+
+FHeadlessLogger::FHeadlessLogger(QObject *parent)
+    : QObject(parent), server(nullptr), account(nullptr), logthread(nullptr), logcompressor(nullptr), signalnotifier(nullptr), records(0), lastreportrecords(0), lastreporttime(0) {}
+
+FHeadlessLogger::~FHeadlessLogger() {
+    if (logthread) {
+        logthread->quit();
+        logthread->wait();
+    }
+}
+
+bool FHeadlessLogger::start() {
+    QString username = settings->getUserAccount();
+    QString password = qEnvironmentVariable("FLIST_PASSWORD");
+    character = settings->getHeadlessCharacter();
+    channels = settings->getHeadlessChannels().split("|||", Qt::SkipEmptyParts);
+    if (username.isEmpty()) {
+        debugMessage("[headless] No account is set. Set Global/account in settings.ini.");
+        return false;
+    }
+    if (password.isEmpty()) {
+        debugMessage("[headless] No password is set. Put it in the FLIST_PASSWORD environment variable.");
+        return false;
+    }
+    if (channels.isEmpty()) {
+        debugMessage("[headless] No rooms to log. Set Headless/channels in settings.ini, separated by |||.");
+        return false;
+    }
+
+    // Old days are compressed as they would be by the full client; the search index isn't needed here.
+    chatlog->recover();
+    logthread = new QThread(this);
+    logcompressor = new FChatLogCompressor(chatlog->getLogRoot(), settings->getLogCompressAfterDays());
+    logcompressor->moveToThread(logthread);
+    connect(logthread, SIGNAL(started()), logcompressor, SLOT(start()));
+    connect(logthread, SIGNAL(finished()), logcompressor, SLOT(deleteLater()));
+    logthread->start();
+
+#ifdef Q_OS_UNIX
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalfds) == 0) {
+        signalnotifier = new QSocketNotifier(signalfds[1], QSocketNotifier::Read, this);
+        connect(signalnotifier, SIGNAL(activated(QSocketDescriptor, QSocketNotifier::Type)), this, SLOT(reportStats()));
+        struct sigaction action;
+        action.sa_handler = usr1Handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
+    } else {
+        debugMessage("[headless] Could not set up SIGUSR1; statistics won't be available.");
+    }
+#endif
+    uptime.start();
+
+    server = new FServer(this);
+    account = server->addAccount();
+    account->ui = this;
+    connect(account, SIGNAL(loginComplete(FAccount *)), this, SLOT(loginComplete(FAccount *)));
+    connect(account, SIGNAL(loginError(FAccount *, QString, QString)), this, SLOT(loginError(FAccount *, QString, QString)));
+    debugMessage(QString("[headless] Logging in as '%1'.").arg(username));
+    account->loginUserPass(username, password);
+    return true;
+}
+
+void FHeadlessLogger::loginComplete(FAccount *a) {
+    (void)a;
+    if (character.isEmpty()) {
+        character = account->defaultCharacter;
+    }
+    if (!account->characterList.contains(character)) {
+        debugMessage(QString("[headless] The account has no character called '%1'.").arg(character));
+        QCoreApplication::exit(1);
+        return;
+    }
+    debugMessage(QString("[headless] Connecting as '%1' to log: %2").arg(character, channels.join(", ")));
+    FSession *session = account->addSession(character);
+    session->autojoinchannels = channels;
+    connect(session, SIGNAL(socketErrorSignal(QString)), this, SLOT(socketError(QString)));
+    connect(session, SIGNAL(socketSSLErrorSignal(QString)), this, SLOT(socketError(QString)));
+    session->connectSession();
+}
+
+void FHeadlessLogger::loginError(FAccount *a, QString errortitle, QString errorstring) {
+    (void)a;
+    debugMessage(QString("[headless] %1: %2").arg(errortitle, errorstring));
+    QCoreApplication::exit(1);
+}
+
+void FHeadlessLogger::socketError(QString error) {
+    // The session reconnects by itself; this is only for whoever reads the output.
+    debugMessage("[headless] " + error);
+}
+
+/**
+Print the ingest rate and memory use. Triggered by SIGUSR1.
+ */
+void FHeadlessLogger::reportStats() {
+#ifdef Q_OS_UNIX
+    char c;
+    ssize_t got = ::read(signalfds[1], &c, sizeof(c));
+    (void)got;
+#endif
+    qint64 now = uptime.elapsed();
+    double interval = qMax<qint64>(now - lastreporttime, 1) / 1000.0;
+    double rate = (records - lastreportrecords) / interval;
+    double average = records / qMax(now / 1000.0, 0.001);
+    lastreporttime = now;
+    lastreportrecords = records;
+
+    // Sessions share one directory, so this counts each character once however many sessions see it.
+    int characters = server ? server->characters.count() : 0;
+    qint64 rss = residentBytes();
+    debugMessage(QString("[headless] Up %1 s. %2 records logged, %3/s since the last report, %4/s on average. %5 rooms joined, %6 characters online. Resident memory: %7.")
+                         .arg(now / 1000)
+                         .arg(records)
+                         .arg(rate, 0, 'f', 2)
+                         .arg(average, 0, 'f', 2)
+                         .arg(joined.count())
+                         .arg(characters)
+                         .arg(rss < 0 ? QString("unknown") : QString("%1 KiB").arg(rss / 1024)));
+}
+
+void FHeadlessLogger::log(FSession *session, FChannel::ChannelType type, QString name, QString title, QString panelname, FMessage &message) {
+    FChatLogRecord record;
+    record.timestamp = message.getTimeStamp().toMSecsSinceEpoch();
+    record.session = session ? session->character : QString();
+    record.panel = panelname;
+    record.sender = message.getSourceCharacter();
+    record.type = message.getMessageType();
+    record.bbcode = message.getRawMessage();
+    record.html = message.getFormattedMessage();
+    if (chatlog->append(FChatLog::baseName(record.session, type, name, title), record)) {
+        records++;
+    }
+}
+
+void FHeadlessLogger::logChannel(FSession *session, QString channelname, FMessage &message) {
+    FPanelKey key = FPanelKey::channel(session->getSessionID(), channelname);
+    FChannel::ChannelType type = key.kind == FPanelKey::Adhoc ? FChannel::CHANTYPE_ADHOC : FChannel::CHANTYPE_NORMAL;
+    log(session, type, channelname, channeltitles.value(channelname, channelname), key.panelName(), message);
+}
+
+void FHeadlessLogger::logCharacter(FSession *session, QString charactername, FMessage &message) {
+    log(session, FChannel::CHANTYPE_PM, charactername, charactername, FPanelKey::pm(session->getSessionID(), charactername).panelName(), message);
+}
+
+void FHeadlessLogger::logConsole(FSession *session, FMessage &message) {
+    QString panelname = FPanelKey::console().panelName();
+    log(session, FChannel::CHANTYPE_CONSOLE, panelname, panelname, panelname, message);
+}
+
+FSession *FHeadlessLogger::getSession(QString sessionid) {
+    return server ? server->getSession(sessionid) : nullptr;
+}
+
+void FHeadlessLogger::setChatOperator(FSession *session, QString characteroperator, bool opstatus) {
+    (void)session;
+    (void)characteroperator;
+    (void)opstatus;
+}
+
+void FHeadlessLogger::openCharacterProfile(FSession *session, QString charactername) {
+    (void)session;
+    (void)charactername;
+}
+
+void FHeadlessLogger::addCharacterChat(FSession *session, QString charactername) {
+    (void)session;
+    (void)charactername;
+}
+
+void FHeadlessLogger::addChannel(FSession *session, QString name, QString title) {
+    (void)session;
+    channeltitles[name] = title;
+    joined.insert(name);
+}
+
+void FHeadlessLogger::removeChannel(FSession *session, QString name) {
+    (void)session;
+    (void)name;
+}
+
+void FHeadlessLogger::addChannelCharacter(FSession *session, QString channelname, QString charactername, bool notify) {
+    (void)session;
+    (void)channelname;
+    (void)charactername;
+    (void)notify;
+}
+
+void FHeadlessLogger::removeChannelCharacter(FSession *session, QString channelname, QString charactername) {
+    (void)session;
+    (void)channelname;
+    (void)charactername;
+}
+
+void FHeadlessLogger::setChannelOperator(FSession *session, QString channelname, QString charactername, bool opstatus) {
+    (void)session;
+    (void)channelname;
+    (void)charactername;
+    (void)opstatus;
+}
+
+void FHeadlessLogger::joinChannel(FSession *session, QString channelname) {
+    (void)session;
+    debugMessage(QString("[headless] Joined '%1'.").arg(channelname));
+}
+
+void FHeadlessLogger::leaveChannel(FSession *session, QString channelname) {
+    (void)session;
+    joined.remove(channelname);
+    debugMessage(QString("[headless] Left '%1'.").arg(channelname));
+}
+
+void FHeadlessLogger::setChannelDescription(FSession *session, QString channelname, QString description) {
+    (void)session;
+    (void)channelname;
+    (void)description;
+}
+
+void FHeadlessLogger::setChannelMode(FSession *session, QString channelname, ChannelMode mode) {
+    (void)session;
+    (void)channelname;
+    (void)mode;
+}
+
+void FHeadlessLogger::notifyChannelReady(FSession *session, QString channelname) {
+    (void)session;
+    (void)channelname;
+}
+
+void FHeadlessLogger::notifyCharacterOnline(FSession *session, QString charactername, bool online) {
+    (void)session;
+    (void)charactername;
+    (void)online;
+}
+
+void FHeadlessLogger::notifyCharacterStatusUpdate(FSession *session, QString charactername) {
+    (void)session;
+    (void)charactername;
+}
+
+void FHeadlessLogger::setCharacterTypingStatus(FSession *session, QString charactername, TypingStatus typingstatus) {
+    (void)session;
+    (void)charactername;
+    (void)typingstatus;
+}
+
+void FHeadlessLogger::messageMessage(FMessage message) {
+    FSession *session = getSession(message.getSessionID());
+    if (!session) {
+        return;
+    }
+    if (message.getBroadcast()) {
+        logConsole(session, message);
+        return;
+    }
+    foreach (QString charactername, message.getDestinationCharacterList()) {
+        logCharacter(session, charactername, message);
+    }
+    foreach (QString channelname, message.getDestinationChannelList()) {
+        logChannel(session, channelname, message);
+    }
+    if (message.getConsole()) {
+        logConsole(session, message);
+    }
+}
+
+void FHeadlessLogger::messageMany(FSession *session, QList<QString> &channels, QList<QString> &characters, bool system, QString message, MessageType messagetype) {
+    FMessage fmessage(message, messagetype);
+    if (system) {
+        logConsole(session, fmessage);
+    }
+    foreach (QString charactername, characters) {
+        logCharacter(session, charactername, fmessage);
+    }
+    foreach (QString channelname, channels) {
+        logChannel(session, channelname, fmessage);
+    }
+}
+
+void FHeadlessLogger::messageAll(FSession *session, QString message, MessageType messagetype) {
+    FMessage fmessage(message, messagetype);
+    logConsole(session, fmessage);
+}
+
+void FHeadlessLogger::messageChannel(FSession *session, QString channelname, QString message, MessageType messagetype, bool console, bool notify) {
+    (void)notify;
+    FMessage fmessage(message, messagetype);
+    logChannel(session, channelname, fmessage);
+    if (console) {
+        logConsole(session, fmessage);
+    }
+}
+
+void FHeadlessLogger::messageCharacter(FSession *session, QString charactername, QString message, MessageType messagetype) {
+    FMessage fmessage(message, messagetype);
+    logCharacter(session, charactername, fmessage);
+}
+
+void FHeadlessLogger::messageSystem(FSession *session, QString message, MessageType messagetype) {
+    FMessage fmessage(message, messagetype);
+    logConsole(session, fmessage);
+    // Server notices and errors are the only feedback a headless client has.
+    debugMessage("[headless] " + htmlToPlainText(message));
+}
+
+void FHeadlessLogger::updateKnownChannelList(FSession *session) {
+    (void)session;
+}
+
+void FHeadlessLogger::updateKnownOpenRoomList(FSession *session) {
+    (void)session;
+}
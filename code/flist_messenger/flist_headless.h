@@ -0,0 +1,103 @@
+#ifndef FLIST_HEADLESS_H
+#define FLIST_HEADLESS_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+
+#include "flist_iuserinterface.h"
+#include "flist_channel.h"
+#include "flist_message.h"
+
+class QThread;
+class QSocketNotifier;
+class FServer;
+class FAccount;
+class FChatLogCompressor;
+
+// Stands in for the main window when the client is started with
+// --headless: it logs in, joins the configured rooms and writes everything
+// they say to the structured logs, without creating a single widget.
+//
+// Configuration comes from settings.ini: Global/account for the account,
+// Headless/character for the character (the account's default if empty)
+// and Headless/channels for the rooms, separated by "|||". The password is
+// taken from the FLIST_PASSWORD environment variable so it never has to be
+// written to disk.
+//
+// Nothing but the logs is kept, so memory only grows with the number of
+// characters online. SIGUSR1 prints the ingest rate and memory use.
+class FHeadlessLogger : public QObject, public iUserInterface {
+        Q_OBJECT
+    public:
+        explicit FHeadlessLogger(QObject *parent = nullptr);
+        ~FHeadlessLogger();
+
+        // Checks the configuration and starts logging in. False if it can't.
+        bool start();
+
+        virtual FSession *getSession(QString sessionid);
+
+        virtual void setChatOperator(FSession *session, QString characteroperator, bool opstatus);
+
+        virtual void openCharacterProfile(FSession *session, QString charactername);
+        virtual void addCharacterChat(FSession *session, QString charactername);
+
+        virtual void addChannel(FSession *session, QString name, QString title);
+        virtual void removeChannel(FSession *session, QString name);
+        virtual void addChannelCharacter(FSession *session, QString channelname, QString charactername, bool notify);
+        virtual void removeChannelCharacter(FSession *session, QString channelname, QString charactername);
+        virtual void setChannelOperator(FSession *session, QString channelname, QString charactername, bool opstatus);
+        virtual void joinChannel(FSession *session, QString channelname);
+        virtual void leaveChannel(FSession *session, QString channelname);
+        virtual void setChannelDescription(FSession *session, QString channelname, QString description);
+        virtual void setChannelMode(FSession *session, QString channelname, ChannelMode mode);
+        virtual void notifyChannelReady(FSession *session, QString channelname);
+
+        virtual void notifyCharacterOnline(FSession *session, QString charactername, bool online);
+        virtual void notifyCharacterStatusUpdate(FSession *session, QString charactername);
+        virtual void setCharacterTypingStatus(FSession *session, QString charactername, TypingStatus typingstatus);
+
+        virtual void messageMessage(FMessage message);
+        virtual void messageMany(FSession *session, QList<QString> &channels, QList<QString> &characters, bool system, QString message, MessageType messagetype);
+        virtual void messageAll(FSession *session, QString message, MessageType messagetype);
+        virtual void messageChannel(FSession *session, QString channelname, QString message, MessageType messagetype, bool console = false, bool notify = false);
+        virtual void messageCharacter(FSession *session, QString charactername, QString message, MessageType messagetype);
+        virtual void messageSystem(FSession *session, QString message, MessageType messagetype);
+
+        virtual void updateKnownChannelList(FSession *session);
+        virtual void updateKnownOpenRoomList(FSession *session);
+
+    private slots:
+        void loginComplete(FAccount *a);
+        void loginError(FAccount *a, QString errortitle, QString errorstring);
+        void socketError(QString error);
+        void reportStats();
+
+    private:
+        void logChannel(FSession *session, QString channelname, FMessage &message);
+        void logCharacter(FSession *session, QString charactername, FMessage &message);
+        void logConsole(FSession *session, FMessage &message);
+        void log(FSession *session, FChannel::ChannelType type, QString name, QString title, QString panelname, FMessage &message);
+
+        FServer *server;
+        FAccount *account;
+        QString character;
+        QStringList channels;
+        QHash<QString, QString> channeltitles; //< Ad-hoc room titles by channel name; they are part of the log name.
+        QSet<QString> joined;
+
+        QThread *logthread;
+        FChatLogCompressor *logcompressor;
+
+        QSocketNotifier *signalnotifier;
+        QElapsedTimer uptime;
+        qint64 records;           //< Log records written since starting.
+        qint64 lastreportrecords; //< 'records' at the last report.
+        qint64 lastreporttime;    //< 'uptime' at the last report, in milliseconds.
+};
+
+#endif // FLIST_HEADLESS_H
@@ -0,0 +1,318 @@
+#include "flist_imagecache.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "flist_global.h"
+
+static const quint32 MetaVersion = 1;
+
+qint64 FDecodedImage::cost() const {
+    qint64 cost = 0;
+    foreach (const QImage &frame, frames) {
+        cost += frame.sizeInBytes();
+    }
+    return qMax<qint64>(cost, 1);
+}
+
+FImageCache::FImageCache(QNetworkAccessManager *manager, QString cachedir, int ttlhours, qint64 maxbytes, QObject *parent)
+    : QObject(parent), manager(manager), cachedir(cachedir), ttl(qint64(ttlhours) * 60 * 60 * 1000), memory(maxbytes) {}
+
+QUrl FImageCache::avatarUrl(QString name) {
+    return QUrl("https://static.f-list.net/images/avatar/" + name.toLower() + ".png");
+}
+
+QUrl FImageCache::eiconUrl(QString name) {
+    return QUrl("https://static.f-list.net/images/eicon/" + name.toLower() + ".gif");
+}
+
+/**
+Where 'url' is stored on disk, or an empty string if it is not an avatar or eicon. Mirrors the server layout:
+".../images/avatar/foo.png" is stored as "<cachedir>/avatar/foo.png". URLs come from BBCode, so nothing else is allowed
+to name a file: only those two directories, and a single path component that cannot step out of them.
+ */
+QString FImageCache::cachePath(QUrl url) {
+    static const QRegularExpression layout("^/images/(avatar|eicon)/([^/\\\\]+\\.(png|gif))$");
+    QRegularExpressionMatch match = layout.match(url.path());
+    if (url.host() != "static.f-list.net" || !match.hasMatch() || match.captured(2).startsWith('.')) {
+        return QString();
+    }
+    QString kind = match.captured(1);
+    QDir dir(cachedir);
+    if (!dir.exists(kind)) {
+        dir.mkpath(kind);
+    }
+    return dir.absoluteFilePath(kind + "/" + match.captured(2));
+}
+
+FImageCache::Meta FImageCache::readMeta(QString path) {
+    Meta meta;
+    QFile file(path + ".meta");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return meta;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 version;
+    stream >> version;
+    if (version != MetaVersion) {
+        return Meta();
+    }
+    stream >> meta.etag >> meta.lastmodified >> meta.fetched;
+    if (stream.status() != QDataStream::Ok) {
+        return Meta();
+    }
+    return meta;
+}
+
+void FImageCache::writeMeta(QString path, const Meta &meta) {
+    QSaveFile file(path + ".meta");
+    if (!file.open(QIODevice::WriteOnly)) {
+        debugMessage(QString("[image cache] Could not write '%1.meta'.").arg(path));
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << MetaVersion << meta.etag << meta.lastmodified << meta.fetched;
+    file.commit();
+}
+
+// Runs on the thread pool. Reads 'path' unless 'data' is given.
+FDecodedImage FImageCache::decode(QString path, QByteArray data) {
+    FDecodedImage decoded;
+    if (data.isEmpty()) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return decoded;
+        }
+        data = file.readAll();
+    }
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    QImage frame;
+    while (reader.read(&frame)) {
+        if (frame.width() > DisplaySize || frame.height() > DisplaySize) {
+            frame = frame.scaled(DisplaySize, DisplaySize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        decoded.frames.append(frame.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+        // Browsers treat very short delays as "as fast as you like", which is rarely what was meant.
+        int delay = reader.nextImageDelay();
+        decoded.delays.append(delay < MinimumDelay ? DefaultDelay : delay);
+        if (!reader.supportsAnimation()) {
+            break;
+        }
+    }
+    return decoded;
+}
+
+void FImageCache::startDecode(QUrl url, QByteArray data) {
+    if (decoding.contains(url)) {
+        return;
+    }
+    QFutureWatcher<FDecodedImage> *watcher = new QFutureWatcher<FDecodedImage>(this);
+    decoding[url] = watcher;
+    watcher->setProperty("download", !data.isEmpty());
+    connect(watcher, SIGNAL(finished()), this, SLOT(decodeFinished()));
+    watcher->setFuture(QtConcurrent::run(&FImageCache::decode, cachePath(url), data));
+}
+
+void FImageCache::decodeFinished() {
+    QFutureWatcher<FDecodedImage> *watcher = static_cast<QFutureWatcher<FDecodedImage> *>(sender());
+    watcher->deleteLater();
+    QUrl url = decoding.key(watcher);
+    decoding.remove(url);
+    FDecodedImage decoded = watcher->result();
+    QString path = cachePath(url);
+    qint64 validated;
+
+    if (downloads.contains(url) && !watcher->property("download").toBool()) {
+        // A new version arrived while the old disk copy was being decoded.
+        startDecode(url, downloads.value(url).data);
+        return;
+    }
+    if (downloads.contains(url)) {
+        Download download = downloads.take(url);
+        if (decoded.isNull()) {
+            debugMessage(QString("[image cache] '%1' is not a usable image.").arg(url.toString()));
+            fetchFailed(url, ttl);
+            return;
+        }
+        QSaveFile file(path);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(download.data);
+            if (file.commit()) {
+                writeMeta(path, download.meta);
+            }
+        } else {
+            debugMessage(QString("[image cache] Could not write '%1'.").arg(path));
+        }
+        validated = download.meta.fetched;
+    } else if (decoded.isNull()) {
+        debugMessage(QString("[image cache] Discarding undecodable '%1'.").arg(path));
+        QFile::remove(path);
+        QFile::remove(path + ".meta");
+        fetch(url);
+        return;
+    } else {
+        validated = readMeta(path).fetched;
+    }
+
+    // QCache drops the entry itself if it can never fit, and the validation time goes with it.
+    Entry *entry = new Entry;
+    entry->image = decoded;
+    entry->validated = validated;
+    memory.insert(url, entry, decoded.cost());
+    emit imageReady(url);
+    if (!isFresh(validated)) {
+        fetch(url);
+    }
+}
+
+FDecodedImage *FImageCache::lookup(QUrl url) {
+    if (cachePath(url).isEmpty()) {
+        return nullptr;
+    }
+    Entry *entry = memory.object(url);
+    if (entry == nullptr) {
+        if (QFile::exists(cachePath(url))) {
+            startDecode(url, QByteArray());
+        }
+        return nullptr;
+    }
+    if (!isFresh(entry->validated)) {
+        fetch(url);
+    }
+    return &entry->image;
+}
+
+bool FImageCache::isFresh(qint64 validated) {
+    return QDateTime::currentMSecsSinceEpoch() - validated < ttl;
+}
+
+QImage FImageCache::image(QUrl url) {
+    FDecodedImage *entry = lookup(url);
+    return entry ? entry->frames.first() : QImage();
+}
+
+FDecodedImage FImageCache::decoded(QUrl url) {
+    FDecodedImage *entry = lookup(url);
+    return entry ? *entry : FDecodedImage();
+}
+
+void FImageCache::request(QUrl url) {
+    if (cachePath(url).isEmpty()) {
+        debugMessage(QString("[image cache] Not fetching '%1', it is not an avatar or eicon.").arg(url.toString()));
+        return;
+    }
+    if (lookup(url) == nullptr && !decoding.contains(url)) {
+        fetch(url);
+    }
+}
+
+void FImageCache::fetch(QUrl url) {
+    if (inflight.contains(url) || hasFailed(url)) {
+        return;
+    }
+    QNetworkRequest request(url);
+    // Only revalidate if the cached copy is still there to fall back on.
+    QString path = cachePath(url);
+    if (QFile::exists(path)) {
+        Meta meta = readMeta(path);
+        if (!meta.etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", meta.etag);
+        }
+        if (!meta.lastmodified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", meta.lastmodified);
+        }
+    }
+    QNetworkReply *reply = manager->get(request);
+    inflight[url] = reply;
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+}
+
+bool FImageCache::hasFailed(QUrl url) {
+    QHash<QUrl, qint64>::iterator it = failures.find(url);
+    if (it == failures.end()) {
+        return false;
+    }
+    if (*it <= QDateTime::currentMSecsSinceEpoch()) {
+        failures.erase(it);
+        return false;
+    }
+    return true;
+}
+
+/**
+Hold off fetching 'url' again for 'retryafter' milliseconds. Whoever is waiting for it is told, unless an older copy is still there to show.
+ */
+void FImageCache::fetchFailed(QUrl url, qint64 retryafter) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (QHash<QUrl, qint64>::iterator it = failures.begin(); it != failures.end();) {
+        if (*it <= now) {
+            it = failures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    failures[url] = now + retryafter;
+    if (!memory.contains(url) && !decoding.contains(url) && !QFile::exists(cachePath(url))) {
+        emit imageFailed(url);
+    }
+}
+
+void FImageCache::replyFinished() {
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply == nullptr) {
+        return;
+    }
+    reply->deleteLater();
+    QUrl url = reply->request().url();
+    inflight.remove(url);
+
+    QString path = cachePath(url);
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError) {
+        debugMessage(QString("[image cache] Fetching '%1' failed: %2").arg(url.toString(), reply->errorString()));
+        // A missing image stays missing for a while; anything else may be a passing network problem.
+        fetchFailed(url, status == 404 || status == 410 ? ttl : qint64(FailureRetry));
+        return;
+    }
+    failures.remove(url);
+
+    Meta meta;
+    meta.fetched = QDateTime::currentMSecsSinceEpoch();
+    if (status == 304) {
+        Meta old = readMeta(path);
+        meta.etag = old.etag;
+        meta.lastmodified = old.lastmodified;
+        writeMeta(path, meta);
+        Entry *entry = memory.object(url);
+        if (entry) {
+            entry->validated = meta.fetched;
+        } else {
+            startDecode(url, QByteArray());
+        }
+        // Otherwise nothing changed and everyone already has the image.
+        return;
+    }
+
+    meta.etag = reply->rawHeader("ETag");
+    meta.lastmodified = reply->rawHeader("Last-Modified");
+    Download download;
+    download.data = reply->readAll();
+    download.meta = meta;
+    // If the old disk copy is still being decoded, decodeFinished() starts on this one afterwards.
+    downloads[url] = download;
+    startDecode(url, download.data);
+}
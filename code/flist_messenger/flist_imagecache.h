@@ -0,0 +1,114 @@
+#ifndef FLIST_IMAGECACHE_H
+#define FLIST_IMAGECACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QImage>
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QVector>
+#include <QFutureWatcher>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// An image decoded and scaled down to display size. Animated images hold
+// every frame along with how long each is shown.
+class FDecodedImage {
+    public:
+        bool isNull() const { return frames.isEmpty(); }
+        bool isAnimated() const { return frames.size() > 1; }
+        qint64 cost() const;
+
+        QVector<QImage> frames;
+        QVector<int> delays; //< Milliseconds.
+};
+
+// Process wide cache for images served from static.f-list.net.
+//
+// Images live in a memory cache bounded by bytes and in the on-disk
+// "cache/" tree, next to a small ".meta" file holding the ETag and
+// Last-Modified of the response and when it was last validated. Within the
+// TTL a cached copy is used without touching the network; after that it is
+// still served while a conditional request revalidates it. Concurrent
+// requests for the same URL share one download. A URL that could not be
+// fetched is not tried again for a while: for the TTL after a 404 or an
+// undecodable response, for FailureRetry after a network error.
+//
+// Decoding happens on the global thread pool. Every frame is scaled to fit
+// DisplaySize there, so the GUI thread only ever sees small finished
+// images, and the memory cache holds the scaled frames rather than the
+// original file.
+class FImageCache : public QObject {
+        Q_OBJECT
+    public:
+        static const int DisplaySize = 50;
+        static const int DefaultDelay = 100;
+        static const int MinimumDelay = 20;
+        static const int FailureRetry = 60 * 1000; //< Milliseconds before retrying after a network error.
+
+        explicit FImageCache(QNetworkAccessManager *manager, QString cachedir, int ttlhours, qint64 maxbytes, QObject *parent = nullptr);
+
+        static QUrl avatarUrl(QString name);
+        static QUrl eiconUrl(QString name);
+
+        // The first frame if the image is in memory, otherwise a null image. Stale copies are revalidated in the background.
+        QImage image(QUrl url);
+        // Every frame, with the same rules as image().
+        FDecodedImage decoded(QUrl url);
+        // Make 'url' available in memory, from disk or the network as needed. imageReady() follows once it is, imageFailed() if it can't be.
+        void request(QUrl url);
+        // Whether 'url' failed recently and won't be fetched again until its backoff is over.
+        bool hasFailed(QUrl url);
+
+    signals:
+        void imageReady(QUrl url);
+        void imageFailed(QUrl url);
+
+    private slots:
+        void replyFinished();
+        void decodeFinished();
+
+    private:
+        class Meta {
+            public:
+                Meta() : fetched(0) {}
+                QByteArray etag;
+                QByteArray lastmodified;
+                qint64 fetched; //< Milliseconds since the epoch.
+        };
+        class Entry {
+            public:
+                FDecodedImage image;
+                qint64 validated; //< When the image was last confirmed current, milliseconds since the epoch.
+        };
+        class Download {
+            public:
+                QByteArray data;
+                Meta meta;
+        };
+
+        static FDecodedImage decode(QString path, QByteArray data);
+
+        QString cachePath(QUrl url);
+        FDecodedImage *lookup(QUrl url);
+        void startDecode(QUrl url, QByteArray data);
+        Meta readMeta(QString path);
+        void writeMeta(QString path, const Meta &meta);
+        bool isFresh(qint64 validated);
+        void fetch(QUrl url);
+        void fetchFailed(QUrl url, qint64 retryafter);
+
+        QNetworkAccessManager *manager;
+        QString cachedir;
+        qint64 ttl;
+        QCache<QUrl, Entry> memory;
+        QHash<QUrl, QNetworkReply *> inflight;
+        QHash<QUrl, QFutureWatcher<FDecodedImage> *> decoding;
+        QHash<QUrl, Download> downloads; //< Fresh downloads waiting on their decode before being written to disk.
+        QHash<QUrl, qint64> failures;    //< URLs that could not be fetched -> when they may be tried again. Expired entries are dropped.
+};
+
+#endif // FLIST_IMAGECACHE_H
@@ -30,8 +30,6 @@ public:
 	virtual void notifyCharacterOnline(FSession *session, QString charactername, bool online) = 0;
 	virtual void notifyCharacterStatusUpdate(FSession *session, QString charactername) = 0;
 	virtual void setCharacterTypingStatus(FSession *session, QString charactername, TypingStatus typingstatus) = 0;
-	virtual void notifyCharacterCustomKinkDataUpdated(FSession *session, QString charactername) = 0;
-	virtual void notifyCharacterProfileDataUpdated(FSession *session, QString charactername) = 0;
 
 	virtual void messageMessage(FMessage message) = 0;
 	virtual void messageMany(FSession *session, QList<QString> &channels, QList<QString> &characters, bool system, QString message, MessageType messagetype) = 0;
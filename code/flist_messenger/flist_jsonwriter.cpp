@@ -0,0 +1,97 @@
+#include "flist_jsonwriter.h"
+
+#include <cstring>
+
+FJsonWriter::FJsonWriter(const char *command) {
+    // Most commands fit without growing; long messages grow it once or twice.
+    buffer.reserve(128);
+    buffer.append(QLatin1String(command));
+}
+
+FJsonWriter FJsonWriter::fromFrame(QString frame) {
+    FJsonWriter writer;
+    writer.buffer = frame;
+    return writer;
+}
+
+FJsonWriter &FJsonWriter::field(const char *key, const QString &value) {
+    if (fields.isEmpty()) {
+        buffer.append(QLatin1String(" {"));
+    } else {
+        // Reopen the object; the buffer was left holding a complete frame.
+        buffer.chop(1);
+        buffer.append(QLatin1Char(','));
+    }
+    buffer.append(QLatin1Char('"'));
+    buffer.append(QLatin1String(key));
+    buffer.append(QLatin1String("\":"));
+    appendString(value);
+    buffer.append(QLatin1Char('}'));
+    fields.append(qMakePair(key, value));
+    return *this;
+}
+
+bool FJsonWriter::hasField(const char *key) const {
+    for (int i = 0; i < fields.size(); i++) {
+        if (std::strcmp(fields.at(i).first, key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString FJsonWriter::value(const char *key) const {
+    for (int i = 0; i < fields.size(); i++) {
+        if (std::strcmp(fields.at(i).first, key) == 0) {
+            return fields.at(i).second;
+        }
+    }
+    return QString();
+}
+
+void FJsonWriter::appendString(const QString &value) {
+    static const char hex[] = "0123456789abcdef";
+    buffer.append(QLatin1Char('"'));
+    const QChar *data = value.constData();
+    int length = value.length();
+    int start = 0;
+    for (int i = 0; i < length; i++) {
+        ushort c = data[i].unicode();
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the run of characters that needed no escaping in one go.
+        buffer.append(data + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"':
+                buffer.append(QLatin1String("\\\""));
+                break;
+            case '\\':
+                buffer.append(QLatin1String("\\\\"));
+                break;
+            case '\n':
+                buffer.append(QLatin1String("\\n"));
+                break;
+            case '\r':
+                buffer.append(QLatin1String("\\r"));
+                break;
+            case '\t':
+                buffer.append(QLatin1String("\\t"));
+                break;
+            case '\b':
+                buffer.append(QLatin1String("\\b"));
+                break;
+            case '\f':
+                buffer.append(QLatin1String("\\f"));
+                break;
+            default:
+                buffer.append(QLatin1String("\\u00"));
+                buffer.append(QLatin1Char(hex[c >> 4]));
+                buffer.append(QLatin1Char(hex[c & 0xf]));
+                break;
+        }
+    }
+    buffer.append(data + start, length - start);
+    buffer.append(QLatin1Char('"'));
+}
@@ -0,0 +1,36 @@
+#ifndef FLIST_JSONWRITER_H
+#define FLIST_JSONWRITER_H
+
+#include <QString>
+#include <QPair>
+#include <QVarLengthArray>
+
+// Builds an outbound command, 'CMD {"key":"value",...}', directly into a
+// single compact string. Every field is a JSON string, escaped as it is
+// appended, and the frame is complete after each field() call.
+//
+// The written fields are also remembered, without copying, so the send
+// queue can look at the recipient or channel without reparsing the frame.
+class FJsonWriter {
+    public:
+        explicit FJsonWriter(const char *command);
+
+        // Wrap a frame that was written elsewhere, such as by /debugsend. It has no fields to look up.
+        static FJsonWriter fromFrame(QString frame);
+
+        FJsonWriter &field(const char *key, const QString &value);
+
+        QString command() const { return buffer.left(3); }
+        const QString &frame() const { return buffer; }
+        bool hasField(const char *key) const;
+        QString value(const char *key) const;
+
+    private:
+        FJsonWriter() {}
+        void appendString(const QString &value);
+
+        QString buffer;
+        QVarLengthArray<QPair<const char *, QString>, 4> fields;
+};
+
+#endif // FLIST_JSONWRITER_H
@@ -0,0 +1,529 @@
+#include "flist_logsearch.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QTimer>
+#include <algorithm>
+
+#include "flist_global.h"
+
+static const quint32 IndexStateMagic = 0x46534946; // "FSIF"
+static const quint32 IndexSegmentMagic = 0x46534958; // "FSIX"
+static const quint32 IndexVersion = 1;
+
+static inline quint64 postingKey(const FLogSearchPosting &posting) {
+    return ((quint64)posting.fileid << 40) ^ (quint64)posting.offset;
+}
+
+FLogSearchIndex::FLogSearchIndex(QString logroot, QObject *parent)
+    : QObject(parent), logroot(logroot), indexdir(logroot + "/index"), bufferedpostings(0), nextsegment(0), flushtimer(0) {
+    qRegisterMetaType<FLogSearchHit>("FLogSearchHit");
+    qRegisterMetaType<QList<FLogSearchHit>>("QList<FLogSearchHit>");
+}
+
+FLogSearchIndex::~FLogSearchIndex() {}
+
+QStringList FLogSearchIndex::tokenize(QString text) {
+    QStringList rv;
+    QString token;
+    text = text.toLower();
+    for (int i = 0; i <= text.length(); i++) {
+        if (i < text.length() && (text[i].isLetterOrNumber() || text[i] == '_')) {
+            token.append(text[i]);
+            continue;
+        }
+        if (token.length() >= 2 && token.length() <= 32 && !rv.contains(token)) {
+            rv.append(token);
+        }
+        token.clear();
+    }
+    return rv;
+}
+
+QString FLogSearchIndex::recordText(const FChatLogRecord &record) {
+    static QRegularExpression bbcodetags("\\[/?[a-zA-Z]+(=[^\\]]*)?\\]");
+    static QRegularExpression htmltags("<[^>]*>");
+    QString text;
+    if (!record.bbcode.isEmpty()) {
+        text = record.bbcode;
+        text.replace(bbcodetags, " ");
+    } else {
+        text = record.html;
+        text.replace(htmltags, " ");
+        text.replace("&quot;", "\"").replace("&lt;", "<").replace("&gt;", ">").replace("&apos;", "'").replace("&nbsp;", " ").replace("&amp;", "&");
+    }
+    if (!record.sender.isEmpty()) {
+        text = record.sender + " " + text;
+    }
+    return text;
+}
+
+void FLogSearchIndex::start() {
+    QDir().mkpath(indexdir);
+    flushtimer = new QTimer(this);
+    flushtimer->setSingleShot(true);
+    flushtimer->setInterval(FlushDelay);
+    connect(flushtimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    loadState();
+    QStringList segmentfiles = QDir(indexdir).entryList(QStringList() << "seg-*.fsi", QDir::Files, QDir::Name);
+    foreach (QString name, segmentfiles) {
+        Segment segment;
+        if (loadSegment(indexdir + "/" + name, segment)) {
+            segments.append(segment);
+        }
+        nextsegment = qMax(nextsegment, name.mid(4, name.length() - 8).toInt() + 1);
+    }
+
+    // Anything logged before the index existed, or while the client was not running, is picked up here.
+    // Days indexed to their end are skipped without opening them, so a launch costs one directory walk.
+    QDirIterator it(logroot, QStringList() << "*.flog" << "*.flogz", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString stem = stemForLogFile(it.next());
+        if (pending.contains(stem) || isIndexed(stem)) {
+            continue;
+        }
+        pending.insert(stem);
+    }
+    QMetaObject::invokeMethod(this, "indexPending", Qt::QueuedConnection);
+}
+
+/**
+Whether indexing has reached the end of the log file 'stem'. Only reads the file's size, or the trailer of a compressed day.
+ */
+bool FLogSearchIndex::isIndexed(QString stem) {
+    if (!fileids.contains(stem)) {
+        return false;
+    }
+    qint64 size = FChatLog::logicalSize(logroot + "/" + stem + ".flog");
+    return size >= 0 && indexedoffset.value(fileids.value(stem)) >= size;
+}
+
+/**
+Index a log file that appeared without going through FChatLog::append(), such as a day converted from the old HTML logs.
+ */
+void FLogSearchIndex::logFileAdded(QString logfile) {
+    QString stem = stemForLogFile(logfile);
+    if (pending.contains(stem) || isIndexed(stem)) {
+        return;
+    }
+    bool idle = pending.isEmpty();
+    pending.insert(stem);
+    if (idle) {
+        QMetaObject::invokeMethod(this, "indexPending", Qt::QueuedConnection);
+    }
+}
+
+void FLogSearchIndex::indexPending() {
+    // One file per pass so that searches queued behind the initial scan are not starved.
+    if (pending.isEmpty()) {
+        return;
+    }
+    QString stem = *pending.begin();
+    pending.erase(pending.begin());
+    catchUp(stem);
+    emit indexingProgress(pending.count());
+    if (!pending.isEmpty()) {
+        QMetaObject::invokeMethod(this, "indexPending", Qt::QueuedConnection);
+    }
+}
+
+QString FLogSearchIndex::stemForLogFile(QString logfile) {
+    QString relative = QDir(logroot).relativeFilePath(logfile);
+    return relative.left(relative.lastIndexOf('.'));
+}
+
+quint32 FLogSearchIndex::fileId(QString stem) {
+    if (fileids.contains(stem)) {
+        return fileids.value(stem);
+    }
+    quint32 id = fileids.count();
+    while (filestems.contains(id)) {
+        id++;
+    }
+    fileids[stem] = id;
+    filestems[id] = stem;
+    indexedoffset[id] = 0;
+    return id;
+}
+
+void FLogSearchIndex::recordAppended(QString logfile, qint64 offset, qint64 next, FChatLogRecord record) {
+    QString stem = stemForLogFile(logfile);
+    quint32 id = fileId(stem);
+    if (qMax(indexedoffset.value(id), qint64(FChatLog::HeaderSize)) != offset) {
+        // An earlier append was missed, or the file was written while the index was behind; read back what is missing.
+        catchUp(stem);
+        return;
+    }
+    addPostings(id, offset, record);
+    indexedoffset[id] = next;
+    scheduleFlush();
+}
+
+void FLogSearchIndex::scheduleFlush() {
+    if (bufferedpostings >= FlushPostings) {
+        flush();
+    } else if (flushtimer && !flushtimer->isActive()) {
+        flushtimer->start();
+    }
+}
+
+void FLogSearchIndex::catchUp(QString stem) {
+    if (isIndexed(stem)) {
+        return;
+    }
+    quint32 id = fileId(stem);
+    FChatLogReader reader(logroot + "/" + stem + ".flog");
+    if (!reader.open()) {
+        return;
+    }
+    qint64 offset = qMax(indexedoffset.value(id), reader.firstOffset());
+    qint64 recordoffset = offset;
+    FChatLogRecord record;
+    while (reader.readNext(offset, record)) {
+        addPostings(id, recordoffset, record);
+        recordoffset = offset;
+    }
+    indexedoffset[id] = offset;
+    scheduleFlush();
+}
+
+void FLogSearchIndex::addPostings(quint32 fileid, qint64 offset, const FChatLogRecord &record) {
+    FLogSearchPosting posting;
+    posting.fileid = fileid;
+    posting.offset = offset;
+    posting.timestamp = record.timestamp;
+    foreach (QString term, tokenize(recordText(record))) {
+        buffer[term].append(posting);
+        bufferedpostings++;
+    }
+}
+
+void FLogSearchIndex::flush() {
+    if (flushtimer) {
+        flushtimer->stop();
+    }
+    if (bufferedpostings > 0) {
+        QString filename = QString("%1/seg-%2.fsi").arg(indexdir).arg(nextsegment, 6, 10, QChar('0'));
+        QStringList terms = buffer.keys();
+        std::sort(terms.begin(), terms.end());
+        if (!writeSegment(filename, terms, [this](const QString &term) { return buffer.value(term); })) {
+            return;
+        }
+        nextsegment++;
+        Segment segment;
+        if (loadSegment(filename, segment)) {
+            segments.append(segment);
+        }
+        buffer.clear();
+        bufferedpostings = 0;
+    }
+    // The state is only written once the postings it covers are on disk. A crash in between re-indexes some records, which search tolerates.
+    saveState();
+    mergeSegments();
+}
+
+bool FLogSearchIndex::loadState() {
+    QFile file(indexdir + "/files.dat");
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version, count;
+    stream >> magic >> version >> count;
+    if (magic != IndexStateMagic || version != IndexVersion) {
+        debugMessage(QString("Ignoring the unrecognised log search state in '%1'.").arg(file.fileName()));
+        return false;
+    }
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        QString stem;
+        quint32 id;
+        qint64 offset;
+        stream >> stem >> id >> offset;
+        fileids[stem] = id;
+        filestems[id] = stem;
+        indexedoffset[id] = offset;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+void FLogSearchIndex::saveState() {
+    QSaveFile file(indexdir + "/files.dat");
+    if (!file.open(QFile::WriteOnly)) {
+        debugMessage(QString("Could not write the log search state '%1': %2").arg(file.fileName(), file.errorString()));
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << IndexStateMagic << IndexVersion << (quint32)fileids.count();
+    for (auto it = fileids.cbegin(); it != fileids.cend(); ++it) {
+        stream << it.key() << it.value() << indexedoffset.value(it.value());
+    }
+    file.commit();
+}
+
+bool FLogSearchIndex::writeSegment(QString filename, QStringList terms, std::function<QVector<FLogSearchPosting>(const QString &)> postings) {
+    // Layout: header, posting lists, sorted term dictionary, offset of the dictionary.
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly)) {
+        debugMessage(QString("Could not write the log search segment '%1': %2").arg(filename, file.errorString()));
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << IndexSegmentMagic << IndexVersion;
+    QVector<TermInfo> infos;
+    infos.reserve(terms.count());
+    foreach (QString term, terms) {
+        QVector<FLogSearchPosting> list = postings(term);
+        TermInfo info;
+        info.offset = file.pos();
+        info.count = list.count();
+        infos.append(info);
+        foreach (const FLogSearchPosting &posting, list) {
+            stream << posting.fileid << posting.offset << posting.timestamp;
+        }
+    }
+    qint64 dictionary = file.pos();
+    stream << (quint32)terms.count();
+    for (int i = 0; i < terms.count(); i++) {
+        stream << terms[i] << infos[i].offset << infos[i].count;
+    }
+    stream << dictionary;
+    return file.commit();
+}
+
+bool FLogSearchIndex::loadSegment(QString filename, Segment &segment) {
+    segment.file = QSharedPointer<QFile>(new QFile(filename));
+    QFile &file = *segment.file;
+    if (!file.open(QFile::ReadOnly) || file.size() < 16) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != IndexSegmentMagic || version != IndexVersion) {
+        debugMessage(QString("Ignoring the unrecognised log search segment '%1'.").arg(filename));
+        return false;
+    }
+    qint64 dictionary;
+    file.seek(file.size() - 8);
+    stream >> dictionary;
+    file.seek(dictionary);
+    quint32 count;
+    stream >> count;
+    segment.filename = filename;
+    segment.size = file.size();
+    segment.terms.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        QString term;
+        TermInfo info;
+        stream >> term >> info.offset >> info.count;
+        segment.terms.insert(term, info);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+How many postings 'term' has, from the segment dictionaries and the buffer, without reading any of them.
+ */
+qint64 FLogSearchIndex::termCount(QString term) {
+    qint64 count = buffer.value(term).count();
+    foreach (const Segment &segment, segments) {
+        count += segment.terms.value(term).count;
+    }
+    return count;
+}
+
+void FLogSearchIndex::readPostings(const Segment &segment, const QString &term, QVector<FLogSearchPosting> &out) {
+    QHash<QString, TermInfo>::const_iterator it = segment.terms.constFind(term);
+    if (it == segment.terms.constEnd() || !segment.file->seek(it->offset)) {
+        return;
+    }
+    QDataStream stream(segment.file.data());
+    stream.setVersion(QDataStream::Qt_5_0);
+    out.reserve(out.count() + it->count);
+    for (quint32 i = 0; i < it->count; i++) {
+        FLogSearchPosting posting;
+        stream >> posting.fileid >> posting.offset >> posting.timestamp;
+        out.append(posting);
+    }
+}
+
+QVector<FLogSearchPosting> FLogSearchIndex::postingsFor(QString term) {
+    QVector<FLogSearchPosting> rv;
+    foreach (const Segment &segment, segments) {
+        readPostings(segment, term, rv);
+    }
+    rv += buffer.value(term);
+    return rv;
+}
+
+static int segmentTier(qint64 size) {
+    int tier = 0;
+    for (qint64 limit = FLogSearchIndex::MergeBase; size > limit && tier < 32; limit *= FLogSearchIndex::MergeFactor) {
+        tier++;
+    }
+    return tier;
+}
+
+/**
+Merge MergeFactor segments of the same tier until no tier has that many. A flush only ever starts merges in the lowest
+tier, and a merge only climbs a tier once that tier has filled up, so every posting is rewritten once per tier: the bytes
+written grow with the bytes added (times the number of tiers) rather than with the size of the index.
+ */
+void FLogSearchIndex::mergeSegments() {
+    for (;;) {
+        QHash<int, QList<int>> tiers;
+        QList<int> merge;
+        for (int i = 0; i < segments.count() && merge.isEmpty(); i++) {
+            QList<int> &tier = tiers[segmentTier(segments[i].size)];
+            tier.append(i);
+            if (tier.count() == MergeFactor) {
+                merge = tier;
+            }
+        }
+        if (merge.isEmpty() || !mergeSegments(merge)) {
+            return;
+        }
+    }
+}
+
+/**
+Rewrite the segments at 'indices' into one, which takes the place of the first of them.
+ */
+bool FLogSearchIndex::mergeSegments(QList<int> indices) {
+    QList<Segment> merging;
+    QSet<QString> termset;
+    foreach (int index, indices) {
+        const Segment &segment = segments.at(index);
+        merging.append(segment);
+        for (auto it = segment.terms.cbegin(); it != segment.terms.cend(); ++it) {
+            termset.insert(it.key());
+        }
+    }
+    QStringList terms = termset.values();
+    std::sort(terms.begin(), terms.end());
+
+    QString filename = QString("%1/seg-%2.fsi").arg(indexdir).arg(nextsegment, 6, 10, QChar('0'));
+    bool written = writeSegment(filename, terms, [&merging](const QString &term) {
+        QVector<FLogSearchPosting> list;
+        foreach (const Segment &segment, merging) {
+            readPostings(segment, term, list);
+        }
+        return list;
+    });
+    if (!written) {
+        return false;
+    }
+    nextsegment++;
+    Segment segment;
+    if (!loadSegment(filename, segment)) {
+        return false;
+    }
+    for (int i = indices.count() - 1; i >= 0; i--) {
+        segments.removeAt(indices.at(i));
+    }
+    segments.insert(indices.first(), segment);
+    QStringList oldfiles;
+    foreach (const Segment &old, merging) {
+        oldfiles.append(old.filename);
+    }
+    // Close the old files before removing them.
+    merging.clear();
+    foreach (QString oldfile, oldfiles) {
+        QFile::remove(oldfile);
+    }
+    return true;
+}
+
+void FLogSearchIndex::search(QString query, int limit) {
+    QList<FLogSearchHit> hits;
+    QString phrase;
+    QString trimmed = query.trimmed();
+    if (trimmed.length() > 2 && trimmed.startsWith('"') && trimmed.endsWith('"')) {
+        phrase = trimmed.mid(1, trimmed.length() - 2);
+    }
+    QStringList terms = tokenize(trimmed);
+    if (terms.isEmpty()) {
+        emit searchFinished(query, hits);
+        return;
+    }
+
+    // Rarest term first, by the counts in the segment dictionaries, so common terms' postings are only read if they help.
+    std::sort(terms.begin(), terms.end(), [this](const QString &a, const QString &b) { return termCount(a) < termCount(b); });
+    QHash<quint64, FLogSearchPosting> candidates;
+    foreach (const FLogSearchPosting &posting, postingsFor(terms[0])) {
+        candidates.insert(postingKey(posting), posting);
+    }
+    // Once a term is much more common than the candidates left, checking each candidate's text is cheaper than reading
+    // its postings, and that check stops as soon as 'limit' hits are found.
+    QStringList unchecked;
+    for (int i = 1; i < terms.count(); i++) {
+        if (candidates.isEmpty() || termCount(terms[i]) > (qint64)candidates.count() * VerifyRatio) {
+            unchecked = terms.mid(i);
+            break;
+        }
+        QSet<quint64> keys;
+        foreach (const FLogSearchPosting &posting, postingsFor(terms[i])) {
+            keys.insert(postingKey(posting));
+        }
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            if (keys.contains(it.key())) {
+                ++it;
+            } else {
+                it = candidates.erase(it);
+            }
+        }
+    }
+
+    QVector<FLogSearchPosting> ordered = candidates.values().toVector();
+    std::sort(ordered.begin(), ordered.end(), [](const FLogSearchPosting &a, const FLogSearchPosting &b) { return a.timestamp > b.timestamp; });
+    QHash<quint32, FChatLogReader *> readers;
+    foreach (const FLogSearchPosting &posting, ordered) {
+        if (hits.count() >= limit) {
+            break;
+        }
+        FChatLogReader *reader = readers.value(posting.fileid);
+        if (!reader) {
+            reader = new FChatLogReader(logroot + "/" + filestems.value(posting.fileid) + ".flog");
+            reader->open();
+            readers.insert(posting.fileid, reader);
+        }
+        FLogSearchHit hit;
+        hit.logfile = reader->getFileName();
+        hit.offset = posting.offset;
+        qint64 offset = posting.offset;
+        if (!reader->isOpen() || !reader->readNext(offset, hit.record)) {
+            continue;
+        }
+        QString text = recordText(hit.record);
+        if (!unchecked.isEmpty()) {
+            QStringList tokens = tokenize(text);
+            bool all = true;
+            foreach (QString term, unchecked) {
+                if (!tokens.contains(term)) {
+                    all = false;
+                    break;
+                }
+            }
+            if (!all) {
+                continue;
+            }
+        }
+        if (!phrase.isEmpty() && !text.contains(phrase, Qt::CaseInsensitive)) {
+            continue;
+        }
+        hits.append(hit);
+    }
+    qDeleteAll(readers);
+    emit searchFinished(query, hits);
+}
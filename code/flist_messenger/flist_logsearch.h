@@ -0,0 +1,126 @@
+#ifndef FLIST_LOGSEARCH_H
+#define FLIST_LOGSEARCH_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QFile>
+#include <functional>
+
+#include "flist_chatlog.h"
+
+class QTimer;
+
+class FLogSearchPosting {
+    public:
+        quint32 fileid;
+        qint64 offset; //< Offset of the record within the log file.
+        qint64 timestamp;
+};
+
+class FLogSearchHit {
+    public:
+        QString logfile;
+        qint64 offset;
+        FChatLogRecord record;
+};
+
+Q_DECLARE_METATYPE(FLogSearchHit)
+Q_DECLARE_METATYPE(QList<FLogSearchHit>)
+
+// On disk inverted index over the structured chat logs.
+//
+// New postings are collected in memory and periodically written out as an
+// immutable segment under "<logroot>/index", holding a sorted term
+// dictionary and the posting lists it points to. Segments of similar size
+// are merged in tiers, so each posting is only rewritten a logarithmic
+// number of times however large the index grows. "files.dat" records how far into each log
+// file indexing has got, so indexing resumes where it left off and
+// existing logs are picked up on first run. Days converted from the old
+// HTML logs are handed over through logFileAdded() as they are converted.
+//
+// The index is meant to live on its own thread; all slots are expected to
+// be invoked through queued connections.
+class FLogSearchIndex : public QObject {
+        Q_OBJECT
+    public:
+        static const int FlushPostings = 200000;
+        static const int FlushDelay = 30000;
+        // Segments are merged MergeFactor at a time, and only with segments of about the same size: tier 0 is
+        // up to MergeBase bytes, and each tier above holds segments MergeFactor times as large.
+        static const int MergeFactor = 4;
+        static const qint64 MergeBase = 4 * 1024 * 1024;
+        // Terms more than this many times as common as the remaining candidates are checked against the records instead.
+        static const int VerifyRatio = 16;
+
+        explicit FLogSearchIndex(QString logroot, QObject *parent = nullptr);
+        ~FLogSearchIndex();
+
+        static QStringList tokenize(QString text);
+        static QString recordText(const FChatLogRecord &record);
+
+    public slots:
+        void start();
+        void flush();
+        void recordAppended(QString logfile, qint64 offset, qint64 next, FChatLogRecord record);
+        void logFileAdded(QString logfile);
+        void search(QString query, int limit = 200);
+
+    signals:
+        void searchFinished(QString query, QList<FLogSearchHit> hits);
+        void indexingProgress(int remaining);
+
+    private slots:
+        void indexPending();
+
+    private:
+        class TermInfo {
+            public:
+                qint64 offset;
+                quint32 count;
+        };
+        class Segment {
+            public:
+                QString filename;
+                QSharedPointer<QFile> file; //< Kept open while the segment is live.
+                qint64 size;
+                QHash<QString, TermInfo> terms;
+        };
+
+        QString stemForLogFile(QString logfile);
+        quint32 fileId(QString stem);
+        bool isIndexed(QString stem);
+        void catchUp(QString stem);
+        void scheduleFlush();
+        void addPostings(quint32 fileid, qint64 offset, const FChatLogRecord &record);
+        qint64 termCount(QString term);
+        QVector<FLogSearchPosting> postingsFor(QString term);
+        static void readPostings(const Segment &segment, const QString &term, QVector<FLogSearchPosting> &out);
+
+        bool loadState();
+        void saveState();
+        bool loadSegment(QString filename, Segment &segment);
+        bool writeSegment(QString filename, QStringList terms, std::function<QVector<FLogSearchPosting>(const QString &)> postings);
+        void mergeSegments();
+        bool mergeSegments(QList<int> indices);
+
+        QString logroot;
+        QString indexdir;
+        QSet<QString> pending;                //< Log files still to be caught up.
+        QHash<QString, quint32> fileids;      //< Log file stem -> id.
+        QHash<quint32, QString> filestems;    //< id -> log file stem.
+        QHash<quint32, qint64> indexedoffset; //< id -> offset indexing has reached.
+        QHash<QString, QVector<FLogSearchPosting>> buffer;
+        int bufferedpostings;
+        QList<Segment> segments;
+        int nextsegment;
+        QTimer *flushtimer;
+};
+
+#endif // FLIST_LOGSEARCH_H
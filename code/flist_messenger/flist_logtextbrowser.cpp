@@ -6,20 +6,23 @@
 #include <QApplication>
 #include <QDesktopServices>
 #include <QScrollBar>
-#include <QFile>
-#include <QDir>
-#include <QImageReader>
-#include <QMovie>
+#include <QRegion>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QAbstractTextDocumentLayout>
 #include "flist_global.h"
+#include "flist_imagecache.h"
+#include "flist_animationclock.h"
 #include "flist_iuserinterface.h"
 #include "flist_session.h"
 
 FLogTextBrowser::FLogTextBrowser(iUserInterface *ui, QWidget *parent) : QTextBrowser(parent), flist_copylink(), flist_copyname(), sessionid(), ui(ui) {
-    manager.setParent(this);
-    signalMapper.setParent(this);
-
-    connect(&manager, SIGNAL(finished(QNetworkReply *)), this, SLOT(resourceLoaded(QNetworkReply *)));
-    connect(&signalMapper, SIGNAL(mappedInt(int)), this, SLOT(animate(int)));
+    connect(imagecache, SIGNAL(imageReady(QUrl)), this, SLOT(resourceReady(QUrl)));
+    connect(imagecache, SIGNAL(imageFailed(QUrl)), this, SLOT(resourceFailed(QUrl)));
+    connect(animationclock, SIGNAL(tick()), this, SLOT(advanceAnimations()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(findVisibleAnimations()));
+    connect(horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(findVisibleAnimations()));
+    connect(document(), SIGNAL(contentsChanged()), this, SLOT(findVisibleAnimations()));
 }
 
 void FLogTextBrowser::contextMenuEvent(QContextMenuEvent *event) {
@@ -122,10 +125,6 @@ void FLogTextBrowser::confirmReport() {
 }
 
 void FLogTextBrowser::append(const QString &text) {
-    QString newText = identifyAndLoadServerResources(text);
-
-    // debugMessage("Going to append: " + newText);
-
     QTextCursor cur = textCursor();
     if (cur.hasSelection()) {
         int oldPosition = cur.position();
@@ -134,7 +133,7 @@ void FLogTextBrowser::append(const QString &text) {
         int vpos = verticalScrollBar()->value();
         int vmax = verticalScrollBar()->maximum();
 
-        QTextBrowser::append(newText);
+        QTextBrowser::append(text);
 
         cur.setPosition(oldAnchor, QTextCursor::MoveAnchor);
         cur.setPosition(oldPosition, QTextCursor::KeepAnchor);
@@ -146,172 +145,152 @@ void FLogTextBrowser::append(const QString &text) {
             verticalScrollBar()->setValue(vmax);
         }
     } else {
-        QTextBrowser::append(newText);
+        QTextBrowser::append(text);
     }
 }
 
-void FLogTextBrowser::animate(int id) {
-    // debugMessage("FLogTextBrowser::animate() -> Called with ID: " + QString::number(id));
-
-    if (id < 1 || urls.count() < id) {
-        debugMessage("FLogTextBrowser::animate() -> Mapped out of bounds, exiting.");
-        return;
+QVariant FLogTextBrowser::loadResource(int type, const QUrl &name) {
+    if (type != QTextDocument::ImageResource || name.host() != "static.f-list.net") {
+        return QTextBrowser::loadResource(type, name);
     }
-
-    QPair<QMovie *, QUrl> _data = urls.at(id - 1);
-
-    // debugMessage("FLogTextBrowser::animate() -> Movie found with ID: " + QString::number(id));
-
-    document()->addResource(QTextDocument::ImageResource, _data.second, _data.first->currentPixmap());
-    setLineWrapColumnOrWidth(lineWrapColumnOrWidth());
-}
-
-void FLogTextBrowser::resourceLoaded(QNetworkReply *resource) {
-    for (int i = 0; i < loadedResources.count(); i++) {
-        QNetworkReply *item = loadedResources.at(i);
-
-        if (item != resource || !item->isFinished()) {
-            continue;
+    QImage image = imagecache->image(name);
+    if (image.isNull()) {
+        // Relayouts ask again; a URL that just failed stays broken until the cache is willing to try it again.
+        if (imagecache->hasFailed(name)) {
+            return QVariant();
         }
-
-        copyFileToCache(item->readAll(), resource->url());
+        // Shown as a broken image until resourceReady() hands it over.
+        pendingresources.insert(name);
+        imagecache->request(name);
+        return QVariant();
     }
+    return image;
 }
 
-QString FLogTextBrowser::identifyAndLoadServerResources(const QString &text) {
-    QString resultText = text;
-    // debugMessage("FLogTextBrowser::identifyAndLoadServerResource() -> Called with input text: " + text);
-
-    // this should capture all relevant image links (we only want eicons and avatars, nothing else!)
-    static QRegularExpression reg(R"RX(<img class="e?icon" src="https://static.f-list.net/images/([^()"' ]*)*)RX",
-                                  QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption | QRegularExpression::MultilineOption
-                                          | QRegularExpression::DontCaptureOption);
-
-    // debugMessage("FLogTextBrowser::identifyAndLoadServerResource() -> Is Image RegEx valid? ->" + QString::number(reg.isValid()));
-
-    QRegularExpressionMatchIterator imageMatches = reg.globalMatch(resultText, 0, QRegularExpression::NormalMatch, QRegularExpression::NoMatchOption);
-
-    QStringList capturedTexts;
-
-    while (imageMatches.hasNext()) {
-        QRegularExpressionMatch match = imageMatches.next();
+void FLogTextBrowser::resourceFailed(QUrl url) {
+    pendingresources.remove(url);
+}
 
-        // capture groups start at 0, so we do <=
-        for (int i = 0; i <= reg.captureCount(); ++i) {
-            QString item = match.captured(i);
-            int indexCutoff = item.indexOf("https");
-            item = item.sliced(indexCutoff);
-            capturedTexts.append(item);
-        }
+void FLogTextBrowser::resourceReady(QUrl url) {
+    if (!pendingresources.remove(url)) {
+        return;
     }
-
-    int count = capturedTexts.count();
-
-    if (count < 1) {
-        // debugMessage("FLogTextBrowser::identifyAndLoadServerResource() -> Found no matches, exiting...");
-        return resultText;
+    QImage image = imagecache->image(url);
+    if (image.isNull()) {
+        return;
     }
+    document()->addResource(QTextDocument::ImageResource, url, image);
+    // trigger re-render of our QTextBrowser to display newly loaded resource
+    setLineWrapColumnOrWidth(lineWrapColumnOrWidth());
+    findVisibleAnimations();
+}
 
-    for (int i = 0; i < count; i++) {
-        QString item = capturedTexts.at(i);
-        // debugMessage("FLogTextBrowser::identifyAndLoadServerResource() -> Loading this resource: " + item);
-
-        QUrl _url = QUrl(item);
-        if (loadedUrls.value(_url)) {
-            // already loaded
-            continue;
+void FLogTextBrowser::showEvent(QShowEvent *event) {
+    QTextBrowser::showEvent(event);
+    // Minimising and restoring is only announced to the top level window.
+    if (watchedwindow != window()) {
+        if (watchedwindow) {
+            watchedwindow->removeEventFilter(this);
         }
-
-        QNetworkReply *reply = manager.get(QNetworkRequest(_url));
-        loadedResources.append(reply);
+        watchedwindow = window();
+        watchedwindow->installEventFilter(this);
     }
-
-    return resultText;
+    findVisibleAnimations();
 }
 
-QDir FLogTextBrowser::generateFoldersAndReturnDir(QUrl url) {
-    QDir cache = QDir("cache");
-    if (!cache.exists()) {
-        QDir().mkdir("cache");
+bool FLogTextBrowser::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == watchedwindow && event->type() == QEvent::WindowStateChange) {
+        findVisibleAnimations();
     }
-
-    if (url.toString().contains("eicon")) {
-        if (!cache.cd("eicon")) {
-            cache.mkdir("eicon");
-            cache.cd("eicon");
-        }
-    } else if (url.toString().contains("avatar")) {
-        if (!cache.cd("avatar")) {
-            cache.mkdir("avatar");
-            cache.cd("avatar");
-        }
-    }
-
-    return cache;
+    return QTextBrowser::eventFilter(watched, event);
 }
 
-void FLogTextBrowser::copyFileToCache(QByteArray input, QUrl url) {
-    QString path = generatePathToFile(url);
-    QFile file = QFile(path);
+void FLogTextBrowser::hideEvent(QHideEvent *event) {
+    QTextBrowser::hideEvent(event);
+    // Also sent when the window is minimised.
+    animationclock->setActive(this, false);
+}
 
-    if (!file.open(QIODeviceBase::ReadWrite)) {
-        debugMessage("FLogTextBrowser::copyFileToCache() -> File could not be opened for read/write, exiting.");
-        return;
-    }
+void FLogTextBrowser::resizeEvent(QResizeEvent *event) {
+    QTextBrowser::resizeEvent(event);
+    findVisibleAnimations();
+}
 
-    if (loadedUrls.value(url)) {
-        // resource already exists
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Skipping file that was already loaded and should either be playing or cached.");
-        file.close();
+void FLogTextBrowser::findVisibleAnimations() {
+    visibleanimations.clear();
+    // Also reached from contentsChanged, so new lines arriving while minimised or fully covered must not restart the clock.
+    if (!isVisible() || window()->isMinimized() || viewport()->visibleRegion().isEmpty()) {
+        animationclock->setActive(this, false);
         return;
     }
-
-    file.write(input);
-    file.close();
-
-    loadedUrls.insert(url, true);
-
-    QImageReader imgReader = QImageReader();
-    QString imageFormat = QString(imgReader.imageFormat(path));
-
-    // debugMessage("FLogTextBrowser::copyFileToCache() -> Image Format is: " + imageFormat);
-
-    if (imageFormat.compare("gif", Qt::CaseInsensitive) == 0) {
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Encountered gif, creating movie...");
-        QMovie *movie = new QMovie(this);
-        movie->setFileName(path);
-
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Format: " + QString(movie->format()));
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> frameCount: " + QString::number(movie->frameCount()));
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Speed: " + QString::number(movie->speed()));
-
-        QPair<QMovie *, QUrl> _data;
-        _data.first = movie;
-        _data.second = url;
-        urls.append(_data);
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Added movie to URL list, mapping...");
-        signalMapper.setMapping(movie, urls.count());
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Connecting movie to signal mapper...");
-        connect(movie, SIGNAL(frameChanged(int)), &signalMapper, SLOT(map()));
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Starting movie.");
-
-        // reset all gifs to keep them in sync
-        int _count = urls.count();
-        for (int i = 0; i < _count; i++) {
-            QPair<QMovie *, QUrl> _data = urls.at(i);
-            _data.first->stop();
-            _data.first->start();
+    QRect view = viewport()->rect();
+    QPointF offset(horizontalScrollBar()->value(), verticalScrollBar()->value());
+    QAbstractTextDocumentLayout *layout = document()->documentLayout();
+    for (QTextBlock block = document()->findBlock(cursorForPosition(QPoint(0, 0)).position()); block.isValid(); block = block.next()) {
+        QRectF blockrect = layout->blockBoundingRect(block).translated(-offset);
+        if (blockrect.top() > view.bottom()) {
+            break;
+        }
+        if (blockrect.bottom() < view.top()) {
+            continue;
+        }
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextFragment fragment = it.fragment();
+            if (!fragment.charFormat().isImageFormat()) {
+                continue;
+            }
+            QTextImageFormat format = fragment.charFormat().toImageFormat();
+            QUrl url(format.name());
+            if (url.host() != "static.f-list.net") {
+                continue;
+            }
+            FAnimation animation = animationclock->animation(url);
+            if (!animation.isAnimated()) {
+                continue;
+            }
+            // Consecutive copies of the same image share one fragment, one character each.
+            for (int i = 0; i < fragment.length(); i++) {
+                int position = fragment.position() + i - block.position();
+                QTextLine line = block.layout()->lineForTextPosition(position);
+                if (!line.isValid()) {
+                    continue;
+                }
+                qreal width = format.width() > 0 ? format.width() : line.height();
+                QRectF rect(blockrect.left() + line.cursorToX(position), blockrect.top() + line.y(), width, line.height());
+                if (rect.intersects(view)) {
+                    visibleanimations.append(qMakePair(url, rect.toAlignedRect()));
+                }
+            }
         }
-    } else {
-        // debugMessage("FLogTextBrowser::copyFileToCache() -> Adding resource for url:" + url.toString());
-        document()->addResource(QTextDocument::ImageResource, url, input);
-        // trigger re-render of our QTextBrowser to display newly loaded resource
-        setLineWrapColumnOrWidth(lineWrapColumnOrWidth());
     }
+    animationclock->setActive(this, !visibleanimations.isEmpty());
 }
 
-QString FLogTextBrowser::generatePathToFile(QUrl url) {
-    QDir cache = generateFoldersAndReturnDir(url);
-
-    return cache.absoluteFilePath(url.fileName());
+void FLogTextBrowser::advanceAnimations() {
+    QSet<QUrl> checked;
+    QSet<QUrl> changed;
+    QRegion dirty;
+    for (int i = 0; i < visibleanimations.count(); i++) {
+        const QUrl &url = visibleanimations.at(i).first;
+        if (!checked.contains(url)) {
+            checked.insert(url);
+            FAnimation animation = animationclock->animation(url);
+            if (animation.isNull()) {
+                continue;
+            }
+            int frame = animationclock->frameAt(animation);
+            if (shownframes.value(url, 0) != frame) {
+                shownframes[url] = frame;
+                // Swapping the resource keeps the layout; only the image's own rectangle needs repainting.
+                document()->addResource(QTextDocument::ImageResource, url, animation.frames.at(frame));
+                changed.insert(url);
+            }
+        }
+        if (changed.contains(url)) {
+            dirty += visibleanimations.at(i).second;
+        }
+    }
+    if (!dirty.isEmpty()) {
+        viewport()->update(dirty);
+    }
 }
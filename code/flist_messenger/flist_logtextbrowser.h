@@ -4,8 +4,13 @@
 #include <QString>
 #include <QTextBrowser>
 #include <QTimer>
-#include <QNetworkAccessManager>
-#include <QSignalMapper>
+#include <QSet>
+#include <QHash>
+#include <QUrl>
+#include <QList>
+#include <QPair>
+#include <QRect>
+#include <QPointer>
 
 class iUserInterface;
 
@@ -15,9 +20,15 @@ class FLogTextBrowser : public QTextBrowser {
         explicit FLogTextBrowser(iUserInterface *ui, QWidget *parent = 0);
         void setSessionID(QString sessionid);
         QString getSessionID();
+        // Images from static.f-list.net are served by the shared image cache instead of being fetched per view.
+        virtual QVariant loadResource(int type, const QUrl &name);
 
     protected:
         virtual void contextMenuEvent(QContextMenuEvent *event);
+        virtual void showEvent(QShowEvent *event);
+        virtual void hideEvent(QHideEvent *event);
+        virtual void resizeEvent(QResizeEvent *event);
+        virtual bool eventFilter(QObject *watched, QEvent *event);
     signals:
 
     public slots:
@@ -31,19 +42,16 @@ class FLogTextBrowser : public QTextBrowser {
         void append(const QString &text);
 
     private slots:
-        void animate(int id);
-        void resourceLoaded(QNetworkReply *resource);
+        void resourceReady(QUrl url);
+        void resourceFailed(QUrl url);
+        void advanceAnimations();
+        void findVisibleAnimations();
 
     private:
-        QSignalMapper signalMapper;
-        QNetworkAccessManager manager;
-        QString identifyAndLoadServerResources(const QString &text);
-        QDir generateFoldersAndReturnDir(QUrl url);
-        void copyFileToCache(QByteArray input, QUrl url);
-        QString generatePathToFile(QUrl url);
-        QList<QNetworkReply *> loadedResources;
-        QList<QPair<QMovie *, QUrl>> urls;
-        QHash<QUrl, bool> loadedUrls;
+        QSet<QUrl> pendingresources;                  //< Images the document asked for that are still being fetched.
+        QList<QPair<QUrl, QRect>> visibleanimations; //< Animated images inside the viewport, in viewport coordinates.
+        QHash<QUrl, int> shownframes;                 //< Frame currently handed to the document for each animated image.
+        QPointer<QWidget> watchedwindow;              //< Top level window whose state changes are filtered.
 
         QString flist_copylink;
         QString flist_copyname;
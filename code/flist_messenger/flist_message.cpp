@@ -1,5 +1,6 @@
 #include "flist_message.h"
 #include <QSharedData>
+#include <QStringBuilder>
 #include "flist_global.h"
 
 class FMessageData : public QSharedData {
@@ -7,6 +8,7 @@ public:
 	FMessageData() :
 		timestamp(QDateTime::currentDateTime()),
 		message(),
+		rawmessage(),
 		messagetype(MESSAGE_TYPE_ERROR),
 		sessionid(),
 		destinationchannels(),
@@ -16,13 +18,15 @@ public:
 		console(false),
 		notify(false),
 		broadcast(false),
-		stale(true)
+		stale(true),
+		plainstale(true)
 	{
 	}
 	QDateTime timestamp;
 	QString formattedmessage;
 	QString plaintextmessage;
 	QString message;
+	QString rawmessage; //< The unparsed BBCode, if the message came from one.
 	MessageType messagetype;
 	QString sessionid;
 	QStringList destinationchannels;
@@ -33,6 +37,7 @@ public:
 	bool notify;
 	bool broadcast;
 	bool stale;
+	bool plainstale; //< The plain text is only needed for notifications, so it's made on demand.
 };
 
 FMessage::FMessage() : data(new FMessageData)
@@ -62,6 +67,16 @@ FMessage::~FMessage()
 {
 }
 
+FMessage FMessage::fromFormatted(QString html, MessageType messagetype, qint64 timestamp)
+{
+	FMessage message;
+	message.data->timestamp = QDateTime::fromMSecsSinceEpoch(timestamp);
+	message.data->messagetype = messagetype;
+	message.data->formattedmessage = html;
+	message.data->stale = false;
+	return message;
+}
+
 FMessage &FMessage::toUser(bool notify, bool console)
 {
 	data->notify = notify;
@@ -104,24 +119,44 @@ FMessage &FMessage::fromCharacter(QString charactername)
 	data->sourcecharacter = charactername; 
 	return *this;
 }
+FMessage &FMessage::withRawMessage(QString rawmessage)
+{
+	data->rawmessage = rawmessage;
+	return *this;
+}
 
 QString FMessage::getPlainTextMessage()
 {
-	if(data->stale) {
-		getFormattedMessage();
+	if(data->plainstale) {
+		data->plaintextmessage = htmlToPlainText(getFormattedMessage());
+		data->plainstale = false;
 	}
 	return data->plaintextmessage;
 }
+// The "<small>[hh:mm:ss AP]</small> " prefix for the given time. Messages
+// arrive in bursts within the same second, so the last one is kept.
+static const QString &timestampPrefix(const QDateTime &timestamp)
+{
+	static thread_local qint64 cachedsecond = -1;
+	static thread_local QString cachedprefix;
+	qint64 second = timestamp.toSecsSinceEpoch();
+	if(second != cachedsecond) {
+		cachedprefix = QLatin1String("<small>[") % timestamp.toString("hh:mm:ss AP") % QLatin1String("]</small> ");
+		cachedsecond = second;
+	}
+	return cachedprefix;
+}
+
 QString FMessage::getFormattedMessage()
 {
 	if(data->stale) {
-		data->formattedmessage = QString("<small>[%1]</small> %2").arg(data->timestamp.toString("hh:mm:ss AP"), data->message);
-		data->plaintextmessage = htmlToPlainText(data->formattedmessage);
+		data->formattedmessage = timestampPrefix(data->timestamp) % data->message;
 		data->stale = false;
 	}
 	return data->formattedmessage;
 }
 QString FMessage::getMessage() {return data->message;}
+QString FMessage::getRawMessage() {return data->rawmessage;}
 MessageType FMessage::getMessageType() {return data->messagetype;}
 bool FMessage::getConsole() {return data->console;}
 bool FMessage::getNotify() {return data->notify;}
@@ -9,6 +9,8 @@
 
 class FMessageData;
 
+// A message on its way to one or more panels. Copies share the same record,
+// so a message fanned out to many panels is rendered once and stored once.
 class FMessage
 {
 public:
@@ -18,6 +20,9 @@ public:
 	FMessage &operator=(const FMessage &);
 	~FMessage();
 
+	// A line whose HTML is already final, such as scrollback read back from the logs.
+	static FMessage fromFormatted(QString html, MessageType messagetype, qint64 timestamp);
+
 
 	FMessage &toUser(bool notify = true, bool console = true);
 	FMessage &toBroadcast(bool broadcast = true);
@@ -28,10 +33,12 @@ public:
 	FMessage &fromSession(QString sessionid);
 	FMessage &fromChannel(QString channelname);
 	FMessage &fromCharacter(QString charactername);
+	FMessage &withRawMessage(QString rawmessage);
 
 	QString getPlainTextMessage();
 	QString getFormattedMessage();
 	QString getMessage();
+	QString getRawMessage();
 	MessageType getMessageType();
 	bool getConsole();
 	bool getNotify();
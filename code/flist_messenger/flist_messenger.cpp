@@ -29,8 +29,11 @@
 #include "flist_account.h"
 #include "flist_server.h"
 #include "flist_session.h"
+#include "flist_jsonwriter.h"
 #include "flist_message.h"
 #include "flist_settings.h"
+#include "flist_typingtracker.h"
+#include "flist_chatlog.h"
 #include "flist_attentionsettingswidget.h"
 
 // Bool to string macro
@@ -44,7 +47,7 @@ void flist_messenger::init() {
     settingsPath = QApplication::applicationDirPath() + "/settings.ini";
 }
 
-flist_messenger::flist_messenger(bool d) {
+flist_messenger::flist_messenger(bool d, QElapsedTimer startup) : startupClock(startup), startupLast(0), startupStage(STARTUP_LOGINWINDOW) {
     server = new FServer(this);
     account = server->addAccount();
     account->ui = this;
@@ -64,6 +67,7 @@ flist_messenger::flist_messenger(bool d) {
     recentChannelMenu = 0;
     reportDialog = 0;
     helpDialog = 0;
+    logSearchDialog = 0;
     licenseDialog = nullptr;
     aboutDialog = 0;
     timeoutDialog = 0;
@@ -71,21 +75,78 @@ flist_messenger::flist_messenger(bool d) {
     trayIcon = 0;
     trayIconMenu = 0;
     channelSettingsDialog = 0;
-    createTrayIcon();
     loadSettings();
     loginController = new FLoginController(fapi, account, this);
     setupLoginBox();
     cl_data = new FChannelListModel();
     cl_dialog = 0;
     selfStatus = "online";
+    // Only the login window is built up front. The tray icon, the chat styles and the log thread wait for startConnect(), and every dialog for its first use.
+    QTimer::singleShot(0, this, [this]() { startupMark(STARTUP_LOGINWINDOW); });
+    // Built by startChatServices(), so quitting from the login window has no thread to stop.
+    logThread = nullptr;
+    logSearchIndex = nullptr;
+    logCompressor = nullptr;
+    scrollbackLoader = nullptr;
+}
 
+/**
+Start everything the chat window needs but the login window doesn't: the character and panel styles, the log thread and the tray icon.
+ */
+void flist_messenger::startChatServices() {
     FCharacter::initClass();
     FChannelPanel::initClass();
+    // The search index catches up on existing logs and follows new ones from its own thread. Old days are
+    // compressed on the same thread so the two never race over a file. What a crash left is trimmed first,
+    // while nothing there has a log open.
+    chatlog->recover();
+    logThread = new QThread(this);
+    logSearchIndex = new FLogSearchIndex(chatlog->getLogRoot());
+    logSearchIndex->moveToThread(logThread);
+    logCompressor = new FChatLogCompressor(chatlog->getLogRoot(), settings->getLogCompressAfterDays());
+    logCompressor->moveToThread(logThread);
+    connect(logThread, SIGNAL(started()), logSearchIndex, SLOT(start()));
+    connect(logThread, SIGNAL(started()), logCompressor, SLOT(start()));
+    connect(logThread, SIGNAL(finished()), logSearchIndex, SLOT(deleteLater()));
+    connect(logThread, SIGNAL(finished()), logCompressor, SLOT(deleteLater()));
+    connect(logCompressor, SIGNAL(imported(QString)), logSearchIndex, SLOT(logFileAdded(QString)));
+    scrollbackLoader = new FChatLogScrollbackLoader(chatlog->getLogRoot());
+    scrollbackLoader->moveToThread(logThread);
+    connect(logThread, SIGNAL(finished()), scrollbackLoader, SLOT(deleteLater()));
+    connect(this, SIGNAL(scrollbackRequested(QString, QString, int, qint64)), scrollbackLoader, SLOT(load(QString, QString, int, qint64)));
+    connect(scrollbackLoader, SIGNAL(loaded(QString, QList<FChatLogRecord>)), this, SLOT(scrollbackLoaded(QString, QList<FChatLogRecord>)));
+    connect(chatlog, SIGNAL(recordAppended(QString, qint64, qint64, FChatLogRecord)), logSearchIndex, SLOT(recordAppended(QString, qint64, qint64, FChatLogRecord)));
+    // Only once the thread runs; a blocking call into a thread that never started would never return.
+    connect(qApp, SIGNAL(aboutToQuit()), logSearchIndex, SLOT(flush()), Qt::BlockingQueuedConnection);
+    logThread->start(QThread::LowPriority);
+    createTrayIcon();
+}
+
+/**
+In debug mode, print how long it took to reach 'stage' since the process started, and since the stage before it. Every stage is reported once.
+ */
+void flist_messenger::startupMark(StartupStage stage) {
+    static const char *stagenames[STARTUP_DONE] = {"login window shown", "connected", "first room ready"};
+    if (stage < startupStage) {
+        return;
+    }
+    startupStage = stage + 1;
+    if (!debugging || !startupClock.isValid()) {
+        return;
+    }
+    qint64 now = startupClock.elapsed();
+    printDebugInfo(QString("[startup] %1 after %2 ms (+%3 ms)").arg(stagenames[stage]).arg(now).arg(now - startupLast).toStdString());
+    startupLast = now;
+}
+
+void flist_messenger::sessionIdentified(FSession *session) {
+    (void)session;
+    startupMark(STARTUP_CONNECTED);
 }
 
 void flist_messenger::closeEvent(QCloseEvent *event) {
     if (disconnected) quitApp();
-    if (trayIcon->isVisible()) {
+    if (trayIcon && trayIcon->isVisible()) {
         if (!notificationsAreaMessageShown) {
             QString title("Still running~");
             QString msg(
@@ -141,6 +202,10 @@ void flist_messenger::createTrayIcon() {
 
 flist_messenger::~flist_messenger() {
     // TODO: Delete everything
+    if (logThread) {
+        logThread->quit();
+        logThread->wait();
+    }
     delete cl_dialog;
     delete cl_data;
 }
@@ -174,12 +239,18 @@ void flist_messenger::setupLoginBox() {
 void flist_messenger::startConnect(QString charName) {
     this->charName = charName;
     FSession *session = account->addSession(charName);
+    if (!session) {
+        QMessageBox::critical(this, "Error", "Too many characters are connected already.");
+        return;
+    }
     session->autojoinchannels = defaultChannels;
     this->centralWidget()->deleteLater();
 
+    startChatServices();
     setupRealUI();
     connect(session, SIGNAL(socketErrorSignal(QString)), this, SLOT(receivedSocketError(QString)));
     connect(session, SIGNAL(socketSSLErrorSignal(QString)), this, SLOT(receivedSocketSslError(QString)));
+    connect(session, SIGNAL(identified(FSession *)), this, SLOT(sessionIdentified(FSession *)));
 
     connect(session, SIGNAL(notifyCharacterOnline(FSession *, QString, bool)), this, SLOT(notifyCharacterOnline(FSession *, QString, bool)));
     connect(session, SIGNAL(notifyCharacterStatusUpdate(FSession *, QString)), this, SLOT(notifyCharacterStatusUpdate(FSession *, QString)));
@@ -234,6 +305,17 @@ void flist_messenger::helpDialogRequested() {
     helpDialog->show();
 }
 
+void flist_messenger::logSearchDialogRequested() {
+    if (logSearchDialog == 0 || logSearchDialog->parent() != this) {
+        logSearchDialog = new FLogSearchDialog(this);
+        connect(logSearchDialog, SIGNAL(searchRequested(QString)), logSearchIndex, SLOT(search(QString)));
+        connect(logSearchIndex, SIGNAL(searchFinished(QString, QList<FLogSearchHit>)), logSearchDialog, SLOT(showResults(QString, QList<FLogSearchHit>)));
+        connect(logSearchIndex, SIGNAL(indexingProgress(int)), logSearchDialog, SLOT(showIndexingProgress(int)));
+    }
+    logSearchDialog->show();
+    logSearchDialog->raise();
+}
+
 void flist_messenger::channelSettingsDialogRequested() {
     // This is one that always needs to be setup, because its contents may vary.
     if (setupChannelSettingsDialog()) channelSettingsDialog->show();
@@ -364,7 +446,7 @@ void flist_messenger::cs_btnSaveClicked() {
     if (cs_qsPlainDescription != cs_chanCurrent->description()) {
         std::cout << "Editing description." << std::endl;
         // Update description
-        account->getSessionByCharacter(charName)->setChannelDescription(cs_chanCurrent->getChannelName(), cs_qsPlainDescription);
+        account->getSession(cs_chanCurrent->getSessionID())->setChannelDescription(cs_chanCurrent->getChannelName(), cs_qsPlainDescription);
     }
     // Save settings to the ini file.
     cs_attentionsettings->saveSettings();
@@ -423,20 +505,16 @@ void flist_messenger::handleReportFinished() {
             if (who.trimmed() == "") who = "None";
             QString report = "Current Tab/Channel: " + currentPanel->title() + " | Reporting User: " + who + " | " + problem;
 
-            QVariantMap reportMap;
-
-            reportMap.insert("action", "report");
-            reportMap.insert("logid", logid);
-            reportMap.insert("character", charName);
-            reportMap.insert("report", report);
-
-            QJsonDocument reportDoc;
-            reportDoc.fromVariant(reportMap);
+            FSession *session = currentSession();
+            FJsonWriter command("SFC");
+            command.field("action", "report");
+            command.field("logid", logid);
+            command.field("character", session->character);
+            command.field("report", report);
 
             qDebug() << logid;
 
-            std::string output = "SFC " + reportDoc.toJson(QJsonDocument::Compact).toStdString();
-            sendWS(output);
+            session->wsSend(command);
             reportDialog->hide();
             re_leWho->clear();
             re_teProblem->clear();
@@ -474,7 +552,7 @@ void flist_messenger::reportTicketFinished() {
     QString url_string = QString(FLIST_BASEURL_REPORT) + "?account=";
     url_string += account->getUserName();
     url_string += "&character=";
-    url_string += charName;
+    url_string += currentSession()->character;
     url_string += "&ticket=";
     url_string += account->ticket;
     lurl = url_string;
@@ -589,7 +667,7 @@ void flist_messenger::setupRealUI() {
     console = new FChannelPanel(this, charName, "FCHATSYSTEMCONSOLE", "FCHATSYSTEMCONSOLE", FChannel::CHANTYPE_CONSOLE);
     QString name = "Console";
     console->setTitle(name);
-    channelList["FCHATSYSTEMCONSOLE"] = console;
+    channelList.insert(FPanelKey::console(), console);
 
     if (objectName().isEmpty()) setObjectName("MainWindow");
 
@@ -608,6 +686,9 @@ void flist_messenger::setupRealUI() {
     actionHelp->setObjectName("actionHelp");
     actionHelp->setText("Help");
     actionHelp->setIcon(QIcon(":/images/question.png"));
+    actionSearchLogs = new QAction(this);
+    actionSearchLogs->setObjectName("actionSearchLogs");
+    actionSearchLogs->setText("&Search Logs...");
     actionAbout = new QAction(this);
     actionAbout->setObjectName(QString::fromUtf8("actionAbout"));
     actionAbout->setText(QString::fromUtf8("About"));
@@ -748,7 +829,9 @@ void flist_messenger::setupRealUI() {
     returnFilter = new UseReturn(this);
     plainTextEdit->installEventFilter(returnFilter);
     plainTextEdit->setFrameShape(QFrame::NoFrame);
-    connect(plainTextEdit, SIGNAL(textChanged()), this, SLOT(inputChanged()));
+    typingTracker = new FTypingTracker(plainTextEdit->document(), this);
+    connect(plainTextEdit, SIGNAL(textChanged()), typingTracker, SLOT(edited()));
+    connect(typingTracker, SIGNAL(typingStatusChanged(FChannelPanel *, TypingStatus)), this, SLOT(sendTypingStatus(FChannelPanel *, TypingStatus)));
     QVBoxLayout *vblSouthButtons = new QVBoxLayout;
     btnSendChat = new QPushButton("Send Message");
     btnSendAdv = new QPushButton("Post RP ad");
@@ -783,10 +866,12 @@ void flist_messenger::setupRealUI() {
     menuHelp->addAction(actionLicenses);
     menuHelp->addSeparator();
     menuHelp->addAction(actionAbout);
+    menuFile->addAction(actionSearchLogs);
     menuFile->addAction(actionDisconnect);
     menuFile->addSeparator();
     menuFile->addAction(actionQuit);
     connect(actionHelp, SIGNAL(triggered()), this, SLOT(helpDialogRequested()));
+    connect(actionSearchLogs, SIGNAL(triggered()), this, SLOT(logSearchDialogRequested()));
     connect(actionAbout, SIGNAL(triggered()), this, SLOT(aboutApp()));
     connect(actionQuit, SIGNAL(triggered()), this, SLOT(quitApp()));
     connect(actionLicenses, &QAction::triggered, this, &flist_messenger::licenses);
@@ -882,7 +967,7 @@ void flist_messenger::displayCharacterContextMenu(FCharacter *ch) {
 }
 
 void flist_messenger::cl_joinRequested(QStringList channels) {
-    FSession *session = account->getSession(charName); // TODO: fix this
+    FSession *session = currentSession();
     foreach (QString channel, channels) {
         FChannelPanel *channelpanel = channelList.value(channel);
         if (!channelpanel || !channelpanel->getActive()) {
@@ -1101,16 +1186,12 @@ void flist_messenger::setStatusDialogRequested() {
 }
 
 void flist_messenger::characterInfoDialogRequested() {
-    //[19:48 PM]>>PRO {"character":"Hexxy"}
-    //[19:41 PM]>>KIN {"character":"Cinnamon Flufftail"}
     FSession *session = account->getSession(currentPanel->getSessionID());
     FCharacter *ch = session->getCharacter(ul_recent_name);
     if (!ch) {
         debugMessage(QString("Tried to request character info on the character '%1' but they went offline already!").arg(ul_recent_name));
         return;
     }
-    session->requestProfileKinks(ch->name());
-
     if (!ci_dialog) {
         ci_dialog = new FCharacterInfoDialog(this);
     }
@@ -1220,12 +1301,6 @@ void flist_messenger::receivedSocketSslError(QString sslerrors) {
     messageSystem(0, sslerrors, MESSAGE_TYPE_ERROR);
 }
 
-// todo: Calls to sendWS() are to be replaced with appropriate calls to FSession methods.
-void flist_messenger::sendWS(std::string &input) {
-    FSession *session = account->getSession(charName);
-    session->wsSend(input);
-}
-
 void flist_messenger::changeStatus(QString status, QString statusmsg) {
     selfStatus = status;
     selfStatusMessage = statusmsg;
@@ -1278,32 +1353,13 @@ void flist_messenger::usersCommand() {
     messageSystem(session, msg, MESSAGE_TYPE_FEEDBACK);
 }
 
-void flist_messenger::inputChanged() {
-    if (currentPanel && currentPanel->type() == FChannel::CHANTYPE_PM) {
-        if (plainTextEdit->toPlainText().simplified() == "") {
-            typingCleared(currentPanel);
-            currentPanel->setTypingSelf(TYPING_STATUS_CLEAR);
-        } else {
-            if (currentPanel->getTypingSelf() != TYPING_STATUS_TYPING) {
-                typingContinued(currentPanel);
-                currentPanel->setTypingSelf(TYPING_STATUS_TYPING);
-            }
-        }
+void flist_messenger::sendTypingStatus(FChannelPanel *channel, TypingStatus status) {
+    FSession *session = account->getSession(channel->getSessionID());
+    if (session) {
+        session->sendTypingNotification(channel->recipient(), status);
     }
 }
 
-void flist_messenger::typingCleared(FChannelPanel *channel) {
-    account->getSessionByCharacter(charName)->sendTypingNotification(channel->recipient(), TYPING_STATUS_CLEAR);
-}
-
-void flist_messenger::typingContinued(FChannelPanel *channel) {
-    account->getSessionByCharacter(charName)->sendTypingNotification(channel->recipient(), TYPING_STATUS_TYPING);
-}
-
-void flist_messenger::typingPaused(FChannelPanel *channel) {
-    account->getSessionByCharacter(charName)->sendTypingNotification(channel->recipient(), TYPING_STATUS_PAUSED);
-}
-
 void flist_messenger::ul_pmRequested() {
     openPMTab();
 }
@@ -1313,7 +1369,7 @@ void flist_messenger::ul_infoRequested() {
 }
 
 void flist_messenger::ul_ignoreAdd() {
-    FSession *session = account->getSession(charName); // todo: fix this
+    FSession *session = currentSession();
     if (session->isCharacterIgnored(ul_recent_name)) {
         printDebugInfo("[CLIENT BUG] Tried to ignore somebody who is already on the ignorelist.");
     } else {
@@ -1322,7 +1378,7 @@ void flist_messenger::ul_ignoreAdd() {
 }
 
 void flist_messenger::ul_ignoreRemove() {
-    FSession *session = account->getSession(charName); // todo: fix this
+    FSession *session = currentSession();
     if (!session->isCharacterIgnored(ul_recent_name)) {
         printDebugInfo("[CLIENT BUG] Tried to unignore somebody who is not on the ignorelist.");
     } else {
@@ -1331,19 +1387,19 @@ void flist_messenger::ul_ignoreRemove() {
 }
 
 void flist_messenger::ul_channelBan() {
-    account->getSessionByCharacter(charName)->banFromChannel(currentPanel->getChannelName(), ul_recent_name);
+    currentSession()->banFromChannel(currentPanel->getChannelName(), ul_recent_name);
 }
 
 void flist_messenger::ul_channelKick() {
-    account->getSessionByCharacter(charName)->kickFromChannel(currentPanel->getChannelName(), ul_recent_name);
+    currentSession()->kickFromChannel(currentPanel->getChannelName(), ul_recent_name);
 }
 
 void flist_messenger::ul_chatBan() {
-    account->getSessionByCharacter(charName)->banFromChat(ul_recent_name);
+    currentSession()->banFromChat(ul_recent_name);
 }
 
 void flist_messenger::ul_chatKick() {
-    account->getSessionByCharacter(charName)->kickFromChat(ul_recent_name);
+    currentSession()->kickFromChat(ul_recent_name);
 }
 
 void flist_messenger::ul_chatTimeout() {
@@ -1351,19 +1407,19 @@ void flist_messenger::ul_chatTimeout() {
 }
 
 void flist_messenger::ul_channelOpAdd() {
-    account->getSessionByCharacter(charName)->giveChanop(currentPanel->getChannelName(), ul_recent_name);
+    currentSession()->giveChanop(currentPanel->getChannelName(), ul_recent_name);
 }
 
 void flist_messenger::ul_channelOpRemove() {
-    account->getSessionByCharacter(charName)->takeChanop(currentPanel->getChannelName(), ul_recent_name);
+    currentSession()->takeChanop(currentPanel->getChannelName(), ul_recent_name);
 }
 
 void flist_messenger::ul_chatOpAdd() {
-    account->getSessionByCharacter(charName)->giveGlobalop(ul_recent_name);
+    currentSession()->giveGlobalop(ul_recent_name);
 }
 
 void flist_messenger::ul_chatOpRemove() {
-    account->getSessionByCharacter(charName)->takeGlobalop(ul_recent_name);
+    currentSession()->takeGlobalop(ul_recent_name);
 }
 
 void flist_messenger::ul_profileRequested() {
@@ -1434,7 +1490,7 @@ void flist_messenger::to_btnSubmitClicked() {
         QString error("Didn't fill out all fields.");
         messageSystem(0, error, MESSAGE_TYPE_FEEDBACK);
     } else {
-        account->getSessionByCharacter(charName)->sendCharacterTimeout(who.simplified(), minutes, why.simplified());
+        currentSession()->sendCharacterTimeout(who.simplified(), minutes, why.simplified());
     }
     timeoutDialog->hide();
 }
@@ -1463,16 +1519,15 @@ void flist_messenger::updateChannelMode() {
 }
 
 void flist_messenger::switchTab(QString &tabname) {
-    if (channelList.count(tabname) == 0 && tabname != "CONSOLE") {
+    if (!channelList.contains(tabname) && tabname != "CONSOLE") {
         printDebugInfo("ERROR: Tried to switch to " + tabname.toStdString() + " but it doesn't exist.");
         return;
     }
 
     QString input = plainTextEdit->toPlainText();
 
-    if (currentPanel && currentPanel->type() == FChannel::CHANTYPE_PM && currentPanel->getTypingSelf() == TYPING_STATUS_TYPING) {
-        typingPaused(currentPanel);
-    }
+    // Reports a PM left mid-sentence as paused, and keeps the draft swap below from counting as typing.
+    typingTracker->setPanel(0);
 
     currentPanel->setInput(input);
 
@@ -1488,6 +1543,7 @@ void flist_messenger::switchTab(QString &tabname) {
     lblChannelName->setText(chan->title());
     input = currentPanel->getInput();
     plainTextEdit->setPlainText(input);
+    typingTracker->setPanel(currentPanel);
     plainTextEdit->setFocus();
     currentPanel->setHighlighted(false);
     currentPanel->setHasNewMessages(false);
@@ -1499,6 +1555,26 @@ void flist_messenger::switchTab(QString &tabname) {
     QTimer::singleShot(0, this, SLOT(scrollChatViewEnd()));
     updateChannelMode();
     chatview->setSessionID(currentPanel->getSessionID());
+
+    if (!currentPanel->getScrollbackRequested() && currentPanel->type() != FChannel::CHANTYPE_CONSOLE && settings->getScrollbackLines() > 0) {
+        currentPanel->setScrollbackRequested(true);
+        emit scrollbackRequested(currentPanel->getPanelName(), currentPanel->logBaseName(), settings->getScrollbackLines(), currentPanel->getScrollbackBefore());
+    }
+}
+
+void flist_messenger::scrollbackLoaded(QString panelname, QList<FChatLogRecord> records) {
+    FChannelPanel *channelpanel = channelList.value(panelname);
+    if (!channelpanel || records.isEmpty()) {
+        return;
+    }
+    channelpanel->insertScrollback(records);
+    if (channelpanel == currentPanel) {
+        bool atend = chatview->verticalScrollBar()->value() == chatview->verticalScrollBar()->maximum();
+        refreshChatLines();
+        if (atend) {
+            scrollChatViewEnd();
+        }
+    }
 }
 
 /**
@@ -1527,14 +1603,16 @@ void flist_messenger::openPMTab(QString character) {
         return;
     }
 
-    QString panelname = "PM|||" + session->getSessionID() + "|||" + character;
+    FPanelKey key = FPanelKey::pm(session->getSessionID(), character);
+    QString panelname = key.panelName();
 
-    if (channelList.count(panelname) != 0) {
-        channelList[panelname]->setActive(true);
-        channelList[panelname]->pushButton->setVisible(true);
+    if (FChannelPanel *pmPanel = channelList.value(key)) {
+        pmPanel->setActive(true);
+        pmPanel->pushButton->setVisible(true);
         switchTab(panelname);
     } else {
-        channelList[panelname] = new FChannelPanel(this, session->getSessionID(), panelname, character, FChannel::CHANTYPE_PM);
+        pmPanel = new FChannelPanel(this, session->getSessionID(), panelname, character, FChannel::CHANTYPE_PM);
+        channelList.insert(key, pmPanel);
         FCharacter *charptr = session->getCharacter(character);
         QString paneltitle;
         if (charptr != NULL) {
@@ -1542,7 +1620,6 @@ void flist_messenger::openPMTab(QString character) {
         } else {
             paneltitle = "Private chat with " + character;
         }
-        FChannelPanel *pmPanel = channelList.value(panelname);
         pmPanel->setTitle(paneltitle);
         pmPanel->setRecipient(character);
         pmPanel->pushButton = addToActivePanels(panelname, character, paneltitle);
@@ -1907,6 +1984,31 @@ void flist_messenger::parseInput() {
             QString output = "Refreshed stylesheet from default.qss";
             messageSystem(session, output, MESSAGE_TYPE_FEEDBACK);
             success = true;
+        } else if (slashcommand == "/search") {
+            logSearchDialogRequested();
+            if (parts.count() > 1) {
+                logSearchDialog->setQuery(QStringList(parts.mid(1)).join(' '));
+                logSearchDialog->search();
+            }
+            success = true;
+        } else if (slashcommand == "/exportlog") {
+            QDate day = QDate::currentDate();
+            if (parts.count() > 1) {
+                day = QDate::fromString(parts[1], "yyyy-MM-dd");
+            }
+            if (!day.isValid()) {
+                messageSystem(session, QString("<b>Error:</b> Expected a date in the form yyyy-MM-dd."), MESSAGE_TYPE_FEEDBACK);
+            } else {
+                QString basename = currentPanel->logBaseName();
+                QString htmlfile = QString("%1/export/%2~%3.html").arg(chatlog->getLogRoot(), basename, day.toString("yyyy-MM-dd"));
+                if (chatlog->exportHtml(chatlog->fileName(basename, day), htmlfile)) {
+                    messageSystem(session, QString("Exported the log to %1").arg(htmlfile), MESSAGE_TYPE_FEEDBACK);
+                } else {
+                    messageSystem(session, QString("<b>Error:</b> There is no log for %1 on %2.").arg(currentPanel->title(), day.toString("yyyy-MM-dd")),
+                                  MESSAGE_TYPE_FEEDBACK);
+                }
+            }
+            success = true;
         } else if (slashcommand == "/channeltostring") {
             QString *output = currentPanel->toString();
             messageSystem(session, *output, MESSAGE_TYPE_FEEDBACK);
@@ -1934,7 +2036,7 @@ void flist_messenger::parseInput() {
 void flist_messenger::saveSettings() {
     FChannelPanel *c;
     defaultChannels.clear();
-    foreach (c, channelList) {
+    foreach (c, channelList.panels()) {
         if (c->getActive() && c->type() != FChannel::CHANTYPE_CONSOLE && c->type() != FChannel::CHANTYPE_PM) {
             defaultChannels.append(c->getChannelName());
         }
@@ -1959,8 +2061,6 @@ void flist_messenger::loadSettings() {
 
 void flist_messenger::loadDefaultSettings() {}
 
-#define PANELNAME(channelname, charname) (((channelname).startsWith("ADH-") ? "ADH|||" : "CHAN|||") + (charname) + "|||" + (channelname))
-
 void flist_messenger::flashApp(QString &reason) {
     printDebugInfo(reason.toStdString());
     QApplication::alert(this, 10000);
@@ -1970,6 +2070,14 @@ FSession *flist_messenger::getSession(QString sessionid) {
     return server->getSession(sessionid);
 }
 
+/**
+The session of the panel being looked at, so actions go out as the character that panel belongs to. Falls back to the character the window logged in with.
+ */
+FSession *flist_messenger::currentSession() {
+    FSession *session = currentPanel ? account->getSession(currentPanel->getSessionID()) : 0;
+    return session ? session : account->getSessionByCharacter(charName);
+}
+
 void flist_messenger::setChatOperator(FSession *session, QString characteroperator, bool opstatus) {
     debugMessage((opstatus ? "Added chat operator: " : "Removed chat operator: ") + characteroperator);
     // Sort userlists that contain this character
@@ -1977,8 +2085,7 @@ void flist_messenger::setChatOperator(FSession *session, QString characteroperat
         // Set flag in character
         FCharacter *character = session->getCharacter(characteroperator);
         FChannelPanel *channel = 0;
-        foreach (channel, channelList) {
-            // todo: filter by session
+        foreach (channel, channelList.sessionPanels(session->getSessionID())) {
             if (channel->charList().contains(character)) {
                 // todo: Maybe queue channel sorting as an idle task?
                 channel->sortChars();
@@ -1997,11 +2104,12 @@ void flist_messenger::openCharacterProfile(FSession *session, QString charactern
 }
 
 void flist_messenger::addCharacterChat(FSession *session, QString charactername) {
-    QString panelname = "PM|||" + session->getSessionID() + "|||" + charactername;
-    FChannelPanel *channelpanel = channelList.value(panelname);
+    FPanelKey key = FPanelKey::pm(session->getSessionID(), charactername);
+    FChannelPanel *channelpanel = channelList.value(key);
     if (!channelpanel) {
+        QString panelname = key.panelName();
         channelpanel = new FChannelPanel(this, session->getSessionID(), panelname, charactername, FChannel::CHANTYPE_PM);
-        channelList[panelname] = channelpanel;
+        channelList.insert(key, channelpanel);
         channelpanel->setTitle(charactername);
         channelpanel->setRecipient(charactername);
         FCharacter *character = session->getCharacter(charactername);
@@ -2024,18 +2132,19 @@ void flist_messenger::addCharacterChat(FSession *session, QString charactername)
 void flist_messenger::addChannel(FSession *session, QString channelname, QString title) {
     debugMessage("addChannel(\"" + channelname + "\", \"" + title + "\")");
     FChannelPanel *channelpanel;
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    if (!channelList.contains(panelname)) {
-        if (channelname.startsWith("ADH-")) {
+    FPanelKey key = FPanelKey::channel(session->getSessionID(), channelname);
+    QString panelname = key.panelName();
+    if (!channelList.contains(key)) {
+        if (key.kind == FPanelKey::Adhoc) {
             channelpanel = new FChannelPanel(this, session->getSessionID(), panelname, channelname, FChannel::CHANTYPE_ADHOC);
         } else {
             channelpanel = new FChannelPanel(this, session->getSessionID(), panelname, channelname, FChannel::CHANTYPE_NORMAL);
         }
-        channelList[panelname] = channelpanel;
+        channelList.insert(key, channelpanel);
         channelpanel->setTitle(title);
         channelpanel->pushButton = addToActivePanels(panelname, channelname, title);
     } else {
-        channelpanel = channelList.value(panelname);
+        channelpanel = channelList.value(key);
         // Ensure that the channel's title is set correctly for ad-hoc channels.
         if (channelname != title && channelpanel->title() != title) {
             channelpanel->setTitle(title);
@@ -2055,19 +2164,19 @@ void flist_messenger::removeChannel(FSession *session, QString channelname) {
 
 void flist_messenger::addChannelCharacter(FSession *session, QString channelname, QString charactername, bool notify) {
     FChannelPanel *channelpanel;
-    QString panelname = PANELNAME(channelname, session->getSessionID());
+    FPanelKey key = FPanelKey::channel(session->getSessionID(), channelname);
     if (!session->isCharacterOnline(charactername)) {
         printDebugInfo("[SERVER BUG]: Server told us about a character joining a channel, but we don't know about them yet. " + charactername.toStdString());
         return;
     }
-    if (!channelList.contains(panelname)) {
+    channelpanel = channelList.value(key);
+    if (!channelpanel) {
         printDebugInfo("[BUG]: Told about a character joining a channel, but the panel for the channel doesn't exist. " + channelname.toStdString());
         return;
     }
-    channelpanel = channelList.value(panelname);
     channelpanel->addChar(session->getCharacter(charactername), notify);
     if (charactername == session->character) {
-        switchTab(panelname);
+        switchTab(channelpanel->getPanelName());
     } else {
         if (notify) {
             if (currentPanel->getChannelName() == channelname) {
@@ -2081,16 +2190,15 @@ void flist_messenger::addChannelCharacter(FSession *session, QString channelname
 
 void flist_messenger::removeChannelCharacter(FSession *session, QString channelname, QString charactername) {
     FChannelPanel *channelpanel;
-    QString panelname = PANELNAME(channelname, session->getSessionID());
     if (!session->isCharacterOnline(charactername)) {
         printDebugInfo("[SERVER BUG]: Server told us about a character leaving a channel, but we don't know about them yet. " + charactername.toStdString());
         return;
     }
-    if (!channelList.contains(panelname)) {
+    channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
+    if (!channelpanel) {
         printDebugInfo("[BUG]: Told about a character leaving a channel, but the panel for the channel doesn't exist. " + channelname.toStdString());
         return;
     }
-    channelpanel = channelList.value(panelname);
     channelpanel->remChar(session->getCharacter(charactername));
     if (currentPanel->getChannelName() == channelname) {
         refreshUserlist();
@@ -2099,8 +2207,7 @@ void flist_messenger::removeChannelCharacter(FSession *session, QString channeln
 }
 
 void flist_messenger::setChannelOperator(FSession *session, QString channelname, QString charactername, bool opstatus) {
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    FChannelPanel *channelpanel = channelList.value(panelname);
+    FChannelPanel *channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
     if (channelpanel) {
         if (opstatus) {
             channelpanel->addOp(charactername);
@@ -2125,17 +2232,16 @@ void flist_messenger::joinChannel(FSession *session, QString channelname) {
 This notifies the UI that the given session has now left the given channel. The UI should close or disable the releavent widgets. It should not send any leave commands.
  */
 void flist_messenger::leaveChannel(FSession *session, QString channelname) {
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    if (!channelList.contains(panelname)) {
+    FChannelPanel *channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
+    if (!channelpanel) {
         printDebugInfo("[BUG]: Told to leave a channel, but the panel for the channel doesn't exist. " + channelname.toStdString());
         return;
     }
-    closeChannelPanel(panelname);
+    closeChannelPanel(channelpanel->getPanelName());
 }
 
 void flist_messenger::setChannelDescription(FSession *session, QString channelname, QString description) {
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    FChannelPanel *channelpanel = channelList.value(panelname);
+    FChannelPanel *channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
     if (!channelpanel) {
         printDebugInfo(QString("[BUG]: Was told the description of the channel '%1', but the panel for the channel doesn't exist.").arg(channelname).toStdString());
         return;
@@ -2146,8 +2252,7 @@ void flist_messenger::setChannelDescription(FSession *session, QString channelna
 }
 
 void flist_messenger::setChannelMode(FSession *session, QString channelname, ChannelMode mode) {
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    FChannelPanel *channelpanel = channelList.value(panelname);
+    FChannelPanel *channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
     if (!channelpanel) {
         printDebugInfo(QString("[BUG]: Was told the mode of the channel '%1', but the panel for the channel doesn't exist.").arg(channelname).toStdString());
         return;
@@ -2163,8 +2268,7 @@ void flist_messenger::setChannelMode(FSession *session, QString channelname, Cha
 The initial flood of channel data is complete and delayed tasks like sorting can now be performed.
  */
 void flist_messenger::notifyChannelReady(FSession *session, QString channelname) {
-    QString panelname = PANELNAME(channelname, session->getSessionID());
-    FChannelPanel *channelpanel = channelList.value(panelname);
+    FChannelPanel *channelpanel = channelList.value(FPanelKey::channel(session->getSessionID(), channelname));
     if (!channelpanel) {
         printDebugInfo(QString("[BUG]: Was notified that the channel '%1' was ready, but the panel for the channel doesn't exist.").arg(channelname).toStdString());
         return;
@@ -2173,14 +2277,14 @@ void flist_messenger::notifyChannelReady(FSession *session, QString channelname)
     if (currentPanel == channelpanel) {
         refreshUserlist();
     }
+    startupMark(STARTUP_FIRSTROOM);
 }
 
 void flist_messenger::notifyCharacterOnline(FSession *session, QString charactername, bool online) {
-    QString panelname = "PM|||" + session->getSessionID() + "|||" + charactername;
     QList<QString> channels;
     QList<QString> characters;
     bool system = session->isCharacterFriend(charactername);
-    if (channelList.contains(panelname)) {
+    if (channelList.contains(FPanelKey::pm(session->getSessionID(), charactername))) {
         characters.append(charactername);
         system = true;
         // todo: Update panel with changed online/offline status.
@@ -2192,11 +2296,10 @@ void flist_messenger::notifyCharacterOnline(FSession *session, QString character
 }
 
 void flist_messenger::notifyCharacterStatusUpdate(FSession *session, QString charactername) {
-    QString panelname = "PM|||" + session->getSessionID() + "|||" + charactername;
     QList<QString> channels;
     QList<QString> characters;
     bool system = session->isCharacterFriend(charactername);
-    if (channelList.contains(panelname)) {
+    if (channelList.contains(FPanelKey::pm(session->getSessionID(), charactername))) {
         characters.append(charactername);
         system = true;
         // todo: Update panel with changed status.
@@ -2217,9 +2320,8 @@ void flist_messenger::notifyCharacterStatusUpdate(FSession *session, QString cha
 }
 
 void flist_messenger::setCharacterTypingStatus(FSession *session, QString charactername, TypingStatus typingstatus) {
-    QString panelname = "PM|||" + session->getSessionID() + "|||" + charactername;
     FChannelPanel *channelpanel;
-    channelpanel = channelList.value(panelname);
+    channelpanel = channelList.value(FPanelKey::pm(session->getSessionID(), charactername));
     if (!channelpanel) {
         return;
     }
@@ -2227,33 +2329,6 @@ void flist_messenger::setCharacterTypingStatus(FSession *session, QString charac
     channelpanel->updateButtonColor();
 }
 
-void flist_messenger::notifyCharacterCustomKinkDataUpdated(FSession *session, QString charactername) {
-    if (!ci_dialog) {
-        debugMessage(QString("Received custom kink data for the character '%1' but the profile window has not been created.").arg(charactername));
-        ci_dialog = new FCharacterInfoDialog(this);
-    }
-    FCharacter *character = session->getCharacter(charactername);
-    if (!character) {
-        debugMessage(QString("Received custom kink data for the character '%1' but the character is not known.").arg(charactername));
-        return;
-    }
-    ci_dialog->updateKinks(character);
-}
-
-void flist_messenger::notifyCharacterProfileDataUpdated(FSession *session, QString charactername) {
-    if (!ci_dialog) {
-        debugMessage(QString("Received profile data for the character '%1' but the profile window has not been created.").arg(charactername));
-        ci_dialog = new FCharacterInfoDialog(this);
-    }
-    FCharacter *character = session->getCharacter(charactername);
-    if (!character) {
-        debugMessage(QString("Received profile data for the character '%1' but the character is not known.").arg(charactername));
-        return;
-    }
-
-    ci_dialog->updateProfile(character);
-}
-
 void flist_messenger::notifyIgnoreAdd(FSession *s, QString character) {
     messageSystem(s, QString("%1 has been added to your ignore list.").arg(character), MESSAGE_TYPE_IGNORE_UPDATE);
 }
@@ -2309,7 +2384,7 @@ bool flist_messenger::needsAttention(QString key, FChannelPanel *channelpanel, A
 }
 
 void flist_messenger::messageMessage(FMessage message) {
-    QStringList panelnames;
+    QList<FChannelPanel *> panels;
     QString sessionid = message.getSessionID();
     FSession *session = getSession(sessionid);
     // bool destinationchannelalwaysding = false; //1 or more destination channels that are set to always ding
@@ -2321,7 +2396,6 @@ void flist_messenger::messageMessage(FMessage message) {
     bool message_channel_flash = false;
     bool message_character_flash = false;
     bool message_keyword_flash = false;
-    QString panelname;
     bool globalkeywordmatched = false;
     QString plaintext = message.getPlainTextMessage();
     switch (message.getMessageType()) {
@@ -2346,39 +2420,27 @@ void flist_messenger::messageMessage(FMessage message) {
         // todo: check notify
     } else {
         if (message.getBroadcast()) {
-            // Doing a broadcast, find all panels for this session and flag them.
-            foreach (FChannelPanel *channelpanel, channelList) {
-                if (channelpanel->getSessionID() == sessionid) {
-                    panelnames.append(channelpanel->getPanelName());
-                }
-            }
+            // Doing a broadcast, flag all panels for this session.
+            panels = channelList.sessionPanels(sessionid);
         } else {
             foreach (QString charactername, message.getDestinationCharacterList()) {
-                panelname = "PM|||" + sessionid + "|||" + charactername;
-                panelnames.append(panelname);
+                addMessagePanel(panels, FPanelKey::pm(sessionid, charactername), message.getMessage());
             }
             foreach (QString channelname, message.getDestinationChannelList()) {
-                panelname = PANELNAME(channelname, sessionid);
-                panelnames.append(panelname);
+                addMessagePanel(panels, FPanelKey::channel(sessionid, channelname), message.getMessage());
             }
             if (message.getConsole()) {
-                panelnames.append("FCHATSYSTEMCONSOLE");
+                addMessagePanel(panels, FPanelKey::console(), message.getMessage());
             }
         }
     }
     if (message.getNotify()) {
         // todo: should this be made session aware?
-        if (!panelnames.contains(currentPanel->getPanelName())) {
-            panelnames.append(currentPanel->getPanelName());
+        if (!panels.contains(currentPanel)) {
+            panels.append(currentPanel);
         }
     }
-    foreach (QString panelname, panelnames) {
-        FChannelPanel *channelpanel;
-        channelpanel = channelList.value(panelname);
-        if (!channelpanel) {
-            debugMessage("[BUG] Tried to put a message on '" + panelname + "' but there is no channel panel for it. message:" + message.getFormattedMessage());
-            continue;
-        }
+    foreach (FChannelPanel *channelpanel, panels) {
         // Filter based on message type.
         switch (message.getMessageType()) {
             case MESSAGE_TYPE_LOGIN:
@@ -2441,7 +2503,7 @@ void flist_messenger::messageMessage(FMessage message) {
                     message_keyword_flash |= true;
                 }
                 channelpanel->setHasNewMessages(true);
-                if (panelname.startsWith("PM")) {
+                if (channelpanel->type() == FChannel::CHANTYPE_PM) {
                     channelpanel->setHighlighted(true);
                 }
                 channelpanel->updateButtonColor();
@@ -2461,7 +2523,7 @@ void flist_messenger::messageMessage(FMessage message) {
             default:
                 debugMessage("Unhandled message type " + QString::number(message.getMessageType()) + " for message '" + message.getFormattedMessage() + "'.");
         }
-        channelpanel->addLine(message.getFormattedMessage(), settings->getLogChat());
+        channelpanel->addLine(message, settings->getLogChat());
         if (channelpanel == currentPanel) {
             chatview->append(message.getFormattedMessage());
         }
@@ -2527,17 +2589,25 @@ void flist_messenger::messageMessage(FMessage message) {
     }
 }
 
-void flist_messenger::messageMany(QList<QString> &panelnames, QString message, MessageType messagetype) {
+/**
+Add the panel for 'key' to the panels a message is going to, unless it's already there.
+ */
+void flist_messenger::addMessagePanel(QList<FChannelPanel *> &panels, const FPanelKey &key, const QString &message) {
+    FChannelPanel *channelpanel = channelList.value(key);
+    if (!channelpanel) {
+        debugMessage("[BUG] Tried to put a message on '" + key.panelName() + "' but there is no channel panel for it. message:" + message);
+        return;
+    }
+    if (!panels.contains(channelpanel)) {
+        panels.append(channelpanel);
+    }
+}
+
+void flist_messenger::messageMany(QList<FChannelPanel *> &panels, QString message, MessageType messagetype) {
     // Put the message on all the given channel panels.
-    QString panelname;
-    QString messageout = "<small>[" + QTime::currentTime().toString("hh:mm:ss AP") + "]</small> " + message;
-    foreach (panelname, panelnames) {
-        FChannelPanel *channelpanel;
-        channelpanel = channelList.value(panelname);
-        if (!channelpanel) {
-            debugMessage("[BUG] Tried to put a message on '" + panelname + "' but there is no channel panel for it. message:" + message);
-            continue;
-        }
+    // One record for every panel: rendered once, stored once, shared by reference.
+    FMessage messageout(message, messagetype);
+    foreach (FChannelPanel *channelpanel, panels) {
         // Filter based on message type.
         switch (messagetype) {
             case MESSAGE_TYPE_LOGIN:
@@ -2569,7 +2639,7 @@ void flist_messenger::messageMany(QList<QString> &panelnames, QString message, M
             case MESSAGE_TYPE_CHAT:
                 // todo: trigger sounds
                 channelpanel->setHasNewMessages(true);
-                if (panelname.startsWith("PM")) {
+                if (channelpanel->type() == FChannel::CHANTYPE_PM) {
                     channelpanel->setHighlighted(true);
                 }
                 channelpanel->updateButtonColor();
@@ -2591,7 +2661,7 @@ void flist_messenger::messageMany(QList<QString> &panelnames, QString message, M
         }
         channelpanel->addLine(messageout, true);
         if (channelpanel == currentPanel) {
-            chatview->append(messageout);
+            chatview->append(messageout.getFormattedMessage());
         }
     }
     // todo: Sound support is still less than what it was originally.
@@ -2644,77 +2714,69 @@ void flist_messenger::messageMany(QList<QString> &panelnames, QString message, M
 }
 
 void flist_messenger::messageMany(FSession *session, QList<QString> &channels, QList<QString> &characters, bool system, QString message, MessageType messagetype) {
-    QList<QString> panelnames;
+    QList<FChannelPanel *> panels;
     QString charactername;
     QString channelname;
-    QString panelnamemidfix = "|||" + session->getSessionID() + "|||";
+    QString sessionid = session->getSessionID();
     if (system) {
         // todo: session based consoles?
-        panelnames.append("FCHATSYSTEMCONSOLE");
+        addMessagePanel(panels, FPanelKey::console(), message);
     }
     foreach (charactername, characters) {
-        panelnames.append("PM" + panelnamemidfix + charactername);
+        addMessagePanel(panels, FPanelKey::pm(sessionid, charactername), message);
     }
     foreach (channelname, channels) {
-        if (channelname.startsWith("ADH-")) {
-            panelnames.append("ADH" + panelnamemidfix + channelname);
-        } else {
-            panelnames.append("CHAN" + panelnamemidfix + channelname);
-        }
+        addMessagePanel(panels, FPanelKey::channel(sessionid, channelname), message);
     }
     if (system) {
-        if (!panelnames.contains(currentPanel->getPanelName())) {
-            panelnames.append(currentPanel->getPanelName());
+        if (!panels.contains(currentPanel)) {
+            panels.append(currentPanel);
         }
     }
-    messageMany(panelnames, message, messagetype);
+    messageMany(panels, message, messagetype);
 }
 
 void flist_messenger::messageAll(FSession *session, QString message, MessageType messagetype) {
-    QList<QString> panelnames;
-    FChannelPanel *channelpanel;
     // todo: session based consoles?
-    panelnames.append("FCHATSYSTEMCONSOLE");
-    QString match = "|||" + session->getSessionID() + "|||";
-    // Extract all panels that are relevant to this session.
-    foreach (channelpanel, channelList) {
-        QString panelname = channelpanel->getPanelName();
-        if (panelname.contains(match)) {
-            panelnames.append(panelname);
+    QList<FChannelPanel *> panels;
+    addMessagePanel(panels, FPanelKey::console(), message);
+    // All panels that are relevant to this session.
+    foreach (FChannelPanel *channelpanel, channelList.sessionPanels(session->getSessionID())) {
+        if (!panels.contains(channelpanel)) {
+            panels.append(channelpanel);
         }
     }
-    messageMany(panelnames, message, messagetype);
+    messageMany(panels, message, messagetype);
 }
 
 void flist_messenger::messageChannel(FSession *session, QString channelname, QString message, MessageType messagetype, bool console, bool notify) {
-    QList<QString> panelnames;
-    panelnames.append(PANELNAME(channelname, session->getSessionID()));
+    QList<FChannelPanel *> panels;
+    addMessagePanel(panels, FPanelKey::channel(session->getSessionID(), channelname), message);
     if (console) {
-        panelnames.append("FCHATSYSTEMCONSOLE");
+        addMessagePanel(panels, FPanelKey::console(), message);
     }
     if (notify) {
-        QString panelname = currentPanel->getPanelName();
-        if (!panelnames.contains(panelname)) {
-            panelnames.append(panelname);
+        if (!panels.contains(currentPanel)) {
+            panels.append(currentPanel);
         }
     }
-    messageMany(panelnames, message, messagetype);
+    messageMany(panels, message, messagetype);
 }
 
 void flist_messenger::messageCharacter(FSession *session, QString charactername, QString message, MessageType messagetype) {
-    QList<QString> panelnames;
-    panelnames.append("PM|||" + session->getSessionID() + "|||" + charactername);
-    messageMany(panelnames, message, messagetype);
+    QList<FChannelPanel *> panels;
+    addMessagePanel(panels, FPanelKey::pm(session->getSessionID(), charactername), message);
+    messageMany(panels, message, messagetype);
 }
 
 void flist_messenger::messageSystem(FSession *session, QString message, MessageType messagetype) {
     (void)session; // todo: session based consoles?
-    QList<QString> panelnames;
-    panelnames.append("FCHATSYSTEMCONSOLE");
-    if (currentPanel && !panelnames.contains(currentPanel->getPanelName())) {
-        panelnames.append(currentPanel->getPanelName());
+    QList<FChannelPanel *> panels;
+    addMessagePanel(panels, FPanelKey::console(), message);
+    if (currentPanel && !panels.contains(currentPanel)) {
+        panels.append(currentPanel);
     }
-    messageMany(panelnames, message, messagetype);
+    messageMany(panels, message, messagetype);
 }
 
 void flist_messenger::updateKnownChannelList(FSession *session) {
@@ -2726,9 +2788,9 @@ void flist_messenger::updateKnownOpenRoomList(FSession *session) {
 }
 
 void flist_messenger::createPublicChannel(QString name) {
-    account->getSession(charName)->createPublicChannel(name);
+    currentSession()->createPublicChannel(name);
 }
 
 void flist_messenger::createPrivateChannel(QString name) {
-    account->getSession(charName)->createPrivateChannel(name);
+    currentSession()->createPrivateChannel(name);
 }
@@ -67,6 +67,7 @@
 #include <QCheckBox>
 #include <QIcon>
 #include <QSystemTrayIcon>
+#include <QElapsedTimer>
 #include <QTextBrowser>
 #include <QSettings>
 
@@ -75,6 +76,7 @@
 
 #include "flist_character.h"
 #include "flist_channelpanel.h"
+#include "flist_panelregistry.h"
 #include "flist_sound.h"
 #include "flist_avatar.h"
 #include "flist_parser.h"
@@ -92,12 +94,15 @@
 #include "ui/makeroomdialog.h"
 #include "ui/statusdialog.h"
 #include "ui/friendsdialog.h"
+#include "ui/logsearchdialog.h"
 
 class QSplitter;
+class QThread;
 
 class FAccount;
 class FServer;
 class FAttentionSettingsWidget;
+class FTypingTracker;
 
 // This is a complete mess, login should be pulled out into another class somehow, and decoupled from the UI.
 
@@ -111,7 +116,7 @@ class flist_messenger : public QMainWindow, iUserInterface {
 
         static const QString getSettingsPath() { return settingsPath; }
 
-        flist_messenger(bool d);
+        flist_messenger(bool d, QElapsedTimer startup = QElapsedTimer());
         ~flist_messenger();
 
     public:
@@ -142,8 +147,6 @@ class flist_messenger : public QMainWindow, iUserInterface {
 
     public:
         virtual void setCharacterTypingStatus(FSession *session, QString charactername, TypingStatus typingstatus);
-        virtual void notifyCharacterCustomKinkDataUpdated(FSession *session, QString charactername);
-        virtual void notifyCharacterProfileDataUpdated(FSession *session, QString charactername);
 
         virtual void messageMessage(FMessage message);
         virtual void messageMany(FSession *session, QList<QString> &channels, QList<QString> &characters, bool system, QString message, MessageType messagetype);
@@ -156,7 +159,8 @@ class flist_messenger : public QMainWindow, iUserInterface {
         virtual void updateKnownOpenRoomList(FSession *session);
 
     private:
-        void messageMany(QList<QString> &panelnames, QString message, MessageType messagetype);
+        void messageMany(QList<FChannelPanel *> &panels, QString message, MessageType messagetype);
+        void addMessagePanel(QList<FChannelPanel *> &panels, const FPanelKey &key, const QString &message);
         bool getChannelBool(QString key, FChannelPanel *channelpanel, bool dflt);
         bool needsAttention(QString key, FChannelPanel *channelpanel, AttentionMode dflt);
 
@@ -171,6 +175,7 @@ class flist_messenger : public QMainWindow, iUserInterface {
         QAction *actionDisconnect;
         QAction *actionQuit;
         QAction *actionHelp;
+        QAction *actionSearchLogs;
         QAction *actionAbout;
         QAction *actionLicenses;
         QAction *actionColours;
@@ -204,6 +209,7 @@ class flist_messenger : public QMainWindow, iUserInterface {
         FLogTextBrowser *chatview;
         QLineEdit *lineEdit;
         QPlainTextEdit *plainTextEdit;
+        FTypingTracker *typingTracker; // Decides which typing notifications the current PM gets.
         QListWidget *listWidget;
         QMenu *menuHelp;
         QMenu *menuFile;
@@ -237,11 +243,13 @@ class flist_messenger : public QMainWindow, iUserInterface {
         void characterInfoDialogRequested();
         void reportDialogRequested();
         void helpDialogRequested();
+        void logSearchDialogRequested();
         void channelSettingsDialogRequested();
         void destroyMenu();
         void destroyChanMenu();
         void receivedSocketError(QString socketError);
         void receivedSocketSslError(QString sslerrors);
+        void sessionIdentified(FSession *session);
         void quitApp();
         void aboutApp();
         void licenses();
@@ -249,7 +257,7 @@ class flist_messenger : public QMainWindow, iUserInterface {
         void channelButtonClicked(); // Called when channel button is clicked. This should switch panels, and do other necessary things.
         void updateChannelMode();
         void switchTab(QString &tabname);
-        void inputChanged();
+        void sendTypingStatus(FChannelPanel *channel, TypingStatus status);
         void userListContextMenuRequested(const QPoint &point);
         void friendListContextMenuRequested(QString character);
         void submitReport();
@@ -294,6 +302,10 @@ class flist_messenger : public QMainWindow, iUserInterface {
 
         void cl_joinRequested(QStringList channels);
         void changeStatus(QString status, QString statusmsg);
+        void scrollbackLoaded(QString panelname, QList<FChatLogRecord> records);
+
+    signals:
+        void scrollbackRequested(QString panelname, QString basename, int count, qint64 before);
 
     public:
         void leaveChannelPanel(QString panelname);
@@ -304,6 +316,17 @@ class flist_messenger : public QMainWindow, iUserInterface {
         static const int BUFFERPRIV = 50000; // Buffer limit in private
 
     private:
+        FSession *currentSession();
+
+        // Points on the way to a usable chat, reported in debug mode.
+        enum StartupStage { STARTUP_LOGINWINDOW, STARTUP_CONNECTED, STARTUP_FIRSTROOM, STARTUP_DONE };
+        void startupMark(StartupStage stage);
+        void startChatServices();
+
+        QElapsedTimer startupClock; //< Started at the top of main().
+        qint64 startupLast;         //< 'startupClock' at the last stage reported.
+        int startupStage;           //< The next stage to report.
+
         FAccount *account;
         FServer *server;
 
@@ -312,14 +335,10 @@ class flist_messenger : public QMainWindow, iUserInterface {
         void printDebugInfo(std::string s);
         void createTrayIcon();
         void setupConsole();                                                                      // Makes the console channel.
-        void sendWS(std::string &input);                                                          // Sends messages to the server
         FChannelTab *addToActivePanels(QString &channel, QString &channelname, QString &tooltip); // Adds the newly joined channel to the displayed list of channels
         void refreshUserlist();                                                                   // Refreshes the GUI's userlist, based on what the current panel is
         void refreshChatLines();                                                                  // Refreshes the GUI's chat lines, based on what the current panel is
         void usersCommand();                                                                      // Does the /users thing.
-        void typingPaused(FChannelPanel *channel);
-        void typingContinued(FChannelPanel *channel);
-        void typingCleared(FChannelPanel *channel);
         void saveSettings();
         void loadSettings();
         void loadDefaultSettings();
@@ -343,7 +362,7 @@ class flist_messenger : public QMainWindow, iUserInterface {
         bool disconnected;
         static QString settingsPath;
         bool doingWS;
-        QHash<QString, FChannelPanel *> channelList;
+        FPanelRegistry channelList;
         QString ul_recent_name;
         QString tb_recent_name;
         QMenu *recentCharMenu;
@@ -380,6 +399,11 @@ class flist_messenger : public QMainWindow, iUserInterface {
         QPushButton *re_btnSubmit;
 
         FHelpDialog *helpDialog;
+        FLogSearchDialog *logSearchDialog;
+        FLogSearchIndex *logSearchIndex;
+        FChatLogCompressor *logCompressor;
+        FChatLogScrollbackLoader *scrollbackLoader;
+        QThread *logThread; // Log indexing, compression and scrollback reads run here.
         FAboutDialog *aboutDialog;
 
         QDialog *timeoutDialog; // to stands for timeout
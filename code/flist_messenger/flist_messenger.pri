@@ -0,0 +1,136 @@
+# Everything but main.cpp, so other targets can build against the client's code.
+
+GITREV = $$system(git rev-list --count HEAD)
+GITREVSTR = '\\"$${GITREV}\\"'
+GITHASH = $$system(git rev-parse --short HEAD)
+GITHASHSTR = '\\"$${GITHASH}\\"'
+DEFINES += GIT_REV=\"$${GITREVSTR}\"
+DEFINES += GIT_HASH=\"$${GITHASHSTR}\"
+
+QT += core gui network concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets multimedia websockets
+
+DEPENDPATH += $$PWD
+INCLUDEPATH += $$PWD
+
+# Include static QtKeychain library
+# TODO: Migrate to CMake and link it dynamically
+include($$PWD/../libs/qtkeychain/qtkeychain.pri)
+
+# Input
+HEADERS += \
+    $$PWD/api/flist_socket.h \
+    $$PWD/flist_account.h \
+    $$PWD/flist_avatar.h \
+    $$PWD/flist_imagecache.h \
+    $$PWD/flist_animationclock.h \
+    $$PWD/flist_channeltab.h \
+    $$PWD/flist_character.h \
+    $$PWD/flist_characterpool.h \
+    $$PWD/flist_characterdirectory.h \
+    $$PWD/flist_common.h \
+    $$PWD/flist_global.h \
+    $$PWD/flist_escapes.h \
+    $$PWD/flist_jsonwriter.h \
+    $$PWD/flist_keychainmanager.h \
+    $$PWD/flist_messenger.h \
+    $$PWD/flist_parser.h \
+    $$PWD/flist_session.h \
+    $$PWD/flist_sendqueue.h \
+    $$PWD/flist_spscqueue.h \
+    $$PWD/flist_typingtracker.h \
+    $$PWD/flist_sound.h \
+    $$PWD/flist_server.h \
+    $$PWD/flist_characterprofile.h \
+    $$PWD/flist_iuserinterface.h \
+    $$PWD/flist_channelpanel.h \
+    $$PWD/flist_panelregistry.h \
+    $$PWD/flist_headless.h \
+    $$PWD/flist_channel.h \
+    $$PWD/flist_channelsummary.h \
+    $$PWD/flist_chatlog.h \
+    $$PWD/flist_logsearch.h \
+    $$PWD/flist_enums.h \
+    $$PWD/flist_message.h \
+    $$PWD/flist_logtextbrowser.h \
+    $$PWD/flist_settings.h \
+    $$PWD/flist_attentionsettingswidget.h \
+    $$PWD/flist_loginwindow.h \
+    $$PWD/usereturn.h \
+    $$PWD/flist_logincontroller.h \
+    $$PWD/flist_api.h \
+    $$PWD/api/endpoint_v1.h \
+    $$PWD/api/data.h \
+    $$PWD/ui/licensedialog.h \
+    $$PWD/ui/helpdialog.h \
+    $$PWD/ui/characterinfodialog.h \
+    $$PWD/ui/channellistdialog.h \
+    $$PWD/ui/aboutdialog.h \
+    $$PWD/ui/makeroomdialog.h \
+    $$PWD/ui/statusdialog.h \
+    $$PWD/ui/friendsdialog.h \
+    $$PWD/ui/logsearchdialog.h \
+    $$PWD/ui/addremovelistview.h \
+    $$PWD/notifylist.h \
+    $$PWD/ui/stringcharacterlistmodel.h
+SOURCES += \
+    $$PWD/api/flist_socket.cpp \
+    $$PWD/flist_account.cpp \
+    $$PWD/flist_avatar.cpp \
+    $$PWD/flist_imagecache.cpp \
+    $$PWD/flist_animationclock.cpp \
+    $$PWD/flist_channeltab.cpp \
+    $$PWD/flist_character.cpp \
+    $$PWD/flist_characterpool.cpp \
+    $$PWD/flist_characterdirectory.cpp \
+    $$PWD/flist_global.cpp \
+    $$PWD/flist_escapes.cpp \
+    $$PWD/flist_jsonwriter.cpp \
+    $$PWD/flist_keychainmanager.cpp \
+    $$PWD/flist_messenger.cpp \
+    $$PWD/flist_parser.cpp \
+    $$PWD/flist_session.cpp \
+    $$PWD/flist_sendqueue.cpp \
+    $$PWD/flist_typingtracker.cpp \
+    $$PWD/flist_sound.cpp \
+    $$PWD/flist_characterprofile.cpp \
+    $$PWD/flist_server.cpp \
+    $$PWD/flist_channelpanel.cpp \
+    $$PWD/flist_panelregistry.cpp \
+    $$PWD/flist_headless.cpp \
+    $$PWD/flist_channel.cpp \
+    $$PWD/flist_chatlog.cpp \
+    $$PWD/flist_logsearch.cpp \
+    $$PWD/flist_message.cpp \
+    $$PWD/flist_logtextbrowser.cpp \
+    $$PWD/flist_loginwindow.cpp \
+    $$PWD/usereturn.cpp \
+    $$PWD/flist_logincontroller.cpp \
+    $$PWD/api/endpoint_v1.cpp \
+    $$PWD/api/apihelpers.cpp \
+    $$PWD/flist_settings.cpp \
+    $$PWD/flist_enums.cpp \
+    $$PWD/flist_attentionsettingswidget.cpp \
+    $$PWD/ui/licensedialog.cpp \
+    $$PWD/ui/helpdialog.cpp \
+    $$PWD/ui/characterinfodialog.cpp \
+    $$PWD/ui/channellistdialog.cpp \
+    $$PWD/ui/aboutdialog.cpp \
+    $$PWD/ui/makeroomdialog.cpp \
+    $$PWD/ui/statusdialog.cpp \
+    $$PWD/ui/friendsdialog.cpp \
+    $$PWD/ui/logsearchdialog.cpp \
+    $$PWD/ui/addremovelistview.cpp \
+    $$PWD/notifylist.cpp \
+    $$PWD/ui/stringcharacterlistmodel.cpp
+RESOURCES += $$PWD/resources.qrc
+FORMS += \
+    $$PWD/flist_loginwindow.ui \
+    $$PWD/ui/licensedialog.ui \
+    $$PWD/ui/channellistdialog.ui \
+    $$PWD/ui/aboutdialog.ui \
+    $$PWD/ui/makeroomdialog.ui \
+    $$PWD/ui/statusdialog.ui \
+    $$PWD/ui/friendsdialog.ui \
+    $$PWD/ui/addremovelistview.ui
@@ -0,0 +1,39 @@
+#include "flist_panelregistry.h"
+
+#include "flist_channelpanel.h"
+
+FPanelKey::FPanelKey(Kind kind, const QString &sessionid, const QString &target)
+    : kind(kind), sessionid(sessionid), target(target), hash(qHashMulti(0, int(kind), sessionid, target)) {}
+
+FPanelKey FPanelKey::console() {
+    return FPanelKey(Console, QString(), QString());
+}
+
+FPanelKey FPanelKey::channel(const QString &sessionid, const QString &channelname) {
+    return FPanelKey(channelname.startsWith("ADH-") ? Adhoc : Channel, sessionid, channelname);
+}
+
+FPanelKey FPanelKey::pm(const QString &sessionid, const QString &charactername) {
+    return FPanelKey(PM, sessionid, charactername);
+}
+
+QString FPanelKey::panelName() const {
+    switch (kind) {
+        case Console:
+            return "FCHATSYSTEMCONSOLE";
+        case Channel:
+            return "CHAN|||" + sessionid + "|||" + target;
+        case Adhoc:
+            return "ADH|||" + sessionid + "|||" + target;
+        case PM:
+            return "PM|||" + sessionid + "|||" + target;
+    }
+    return QString();
+}
+
+void FPanelRegistry::insert(const FPanelKey &key, FChannelPanel *panel) {
+    bykey.insert(key, panel);
+    byname.insert(panel->getPanelName(), panel);
+    all.append(panel);
+    bysession[panel->getSessionID()].append(panel);
+}
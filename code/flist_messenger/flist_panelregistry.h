@@ -0,0 +1,68 @@
+#ifndef FLIST_PANELREGISTRY_H
+#define FLIST_PANELREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class FChannelPanel;
+
+// Identifies a panel by what it shows rather than by its display name. The
+// hash is worked out once when the key is made, so looking a key up never
+// rehashes the strings in it.
+class FPanelKey {
+    public:
+        enum Kind { Console, Channel, Adhoc, PM };
+
+        // The console.
+        FPanelKey() : FPanelKey(Console, QString(), QString()) {}
+        static FPanelKey console();
+        // Picks Adhoc or Channel from the channel's name.
+        static FPanelKey channel(const QString &sessionid, const QString &channelname);
+        static FPanelKey pm(const QString &sessionid, const QString &charactername);
+
+        // The panel's string name, as used for its tab and in the logs.
+        QString panelName() const;
+
+        bool operator==(const FPanelKey &other) const {
+            return hash == other.hash && kind == other.kind && target == other.target && sessionid == other.sessionid;
+        }
+        bool operator!=(const FPanelKey &other) const { return !(*this == other); }
+
+        Kind kind;
+        QString sessionid; //< Empty for the console.
+        QString target;    //< Channel or character name.
+        size_t hash;
+
+    private:
+        FPanelKey(Kind kind, const QString &sessionid, const QString &target);
+};
+
+inline size_t qHash(const FPanelKey &key, size_t seed = 0) {
+    return key.hash ^ seed;
+}
+
+// All open panels, found by key on the message paths and by name for the
+// tab buttons, with an index of each session's panels so broadcasts don't
+// have to walk every panel.
+class FPanelRegistry {
+    public:
+        void insert(const FPanelKey &key, FChannelPanel *panel);
+
+        FChannelPanel *value(const FPanelKey &key) const { return bykey.value(key); }
+        FChannelPanel *value(const QString &panelname) const { return byname.value(panelname); }
+        bool contains(const FPanelKey &key) const { return bykey.contains(key); }
+        bool contains(const QString &panelname) const { return byname.contains(panelname); }
+
+        const QList<FChannelPanel *> &panels() const { return all; }
+        // The panels belonging to 'sessionid', the console included.
+        QList<FChannelPanel *> sessionPanels(const QString &sessionid) const { return bysession.value(sessionid); }
+
+    private:
+        QHash<FPanelKey, FChannelPanel *> bykey;
+        QHash<QString, FChannelPanel *> byname;
+        QList<FChannelPanel *> all;
+        QHash<QString, QList<FChannelPanel *>> bysession;
+};
+
+#endif // FLIST_PANELREGISTRY_H
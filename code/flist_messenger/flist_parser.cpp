@@ -21,6 +21,7 @@
 
 #include "flist_parser.h"
 #include "flist_global.h"
+#include "flist_imagecache.h"
 #include <QUrl>
 
 /**
@@ -123,21 +124,30 @@ QString BBCodeParser::BBCodeTagSession::parse(QString& param, QString& content)
 
 QString BBCodeParser::BBCodeTagIcon::parse(QString& param, QString& content) {
     (void)param;
-    static QRegularExpression bbTagIcon("[A-Za-z0-9 \\-_]+", QRegularExpression::CaseInsensitiveOption);
-    if (content.indexOf(bbTagIcon) >= 0) {
+    // The whole name must match: it ends up in a URL path and a cache file name, so '/' and ".." must not get through.
+    static QRegularExpression bbTagIcon("^[A-Za-z0-9 \\-_]+$", QRegularExpression::CaseInsensitiveOption);
+    if (bbTagIcon.match(content).hasMatch()) {
+        QUrl url = FImageCache::avatarUrl(content);
+        // Start the fetch now, while the message is still being decoded, rather than when it is displayed. Headless there is nothing to display it.
+        if (imagecache) {
+            imagecache->request(url);
+        }
         content = content.replace(" ", "%20");
-        return "<a href=\"https://www.f-list.net/c/" + content + "\"><img class=\"icon\" src=\"https://static.f-list.net/images/avatar/" + content.toLower()
-               + ".png\" style=\"width:50px;height:50px;\" align=\"top\"/></a>";
+        return "<a href=\"https://www.f-list.net/c/" + content + "\"><img class=\"icon\" src=\"" + url.toString(QUrl::FullyEncoded)
+               + "\" style=\"width:50px;height:50px;\" align=\"top\"/></a>";
     }
     return content;
 }
 
 QString BBCodeParser::BBCodeTagEicon::parse(QString& param, QString& content) {
     (void)param;
-    static QRegularExpression bbTagEicon("[A-Za-z0-9 \\-_]+", QRegularExpression::CaseInsensitiveOption);
-    if (content.indexOf(bbTagEicon) >= 0) {
-        content = content.replace(" ", "%20");
-        return "<img class=\"eicon\" src=\"https://static.f-list.net/images/eicon/" + content.toLower() + ".gif\" style=\"width:50px;height:50px;\" align=\"top\"/>";
+    static QRegularExpression bbTagEicon("^[A-Za-z0-9 \\-_]+$", QRegularExpression::CaseInsensitiveOption);
+    if (bbTagEicon.match(content).hasMatch()) {
+        QUrl url = FImageCache::eiconUrl(content);
+        if (imagecache) {
+            imagecache->request(url);
+        }
+        return "<img class=\"eicon\" src=\"" + url.toString(QUrl::FullyEncoded) + "\" style=\"width:50px;height:50px;\" align=\"top\"/>";
     }
     return content;
 }
@@ -0,0 +1,150 @@
+#include "flist_sendqueue.h"
+
+#include <cmath>
+
+#include "flist_global.h"
+
+FSendQueue::FSendQueue(QObject *parent) : QObject(parent) {
+    timer.setSingleShot(true);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(dispatch()));
+    clock.start();
+    typing.capacity = TypingBurst;
+    typing.tokens = TypingBurst;
+    typing.interval = TypingInterval;
+    queues[SEND_CONTROL].bucket = &unlimited;
+    queues[SEND_CHAT].bucket = &msgflood;
+    queues[SEND_PRIVATE].bucket = &msgflood;
+    queues[SEND_TYPING].bucket = &typing;
+    queues[SEND_ADVERTISEMENT].bucket = &msgflood;
+    configure(QHash<QString, QString>());
+}
+
+void FSendQueue::configure(const QHash<QString, QString> &servervariables) {
+    bool ok;
+    double flood = servervariables.value("msg_flood").toDouble(&ok);
+    msgflood.interval = (ok && flood > 0.0 ? qint64(flood * 1000.0) : DefaultFloodInterval) + SafetyMargin;
+
+    double lfrpflood = servervariables.value("lfrp_flood").toDouble(&ok);
+    queues[SEND_ADVERTISEMENT].targetinterval = (ok && lfrpflood > 0.0 ? qint64(lfrpflood * 1000.0) : DefaultAdvertisementInterval) + SafetyMargin;
+}
+
+void FSendQueue::enqueue(const FJsonWriter &writer) {
+    Frame entry;
+    entry.frame = writer.frame();
+    QString command = writer.command();
+    SendClass sendclass = SEND_CONTROL;
+    if (command == "MSG") {
+        sendclass = SEND_CHAT;
+    } else if (command == "PRI") {
+        sendclass = SEND_PRIVATE;
+    } else if (command == "RLL") {
+        sendclass = writer.hasField("recipient") ? SEND_PRIVATE : SEND_CHAT;
+    } else if (command == "LRP") {
+        sendclass = SEND_ADVERTISEMENT;
+        entry.target = writer.value("channel");
+    } else if (command == "TPN") {
+        sendclass = SEND_TYPING;
+        entry.coalescekey = "TPN " + writer.value("character");
+    }
+
+    Queue &queue = queues[sendclass];
+    if (!entry.coalescekey.isEmpty()) {
+        for (int i = 0; i < queue.frames.size(); i++) {
+            if (queue.frames.at(i).coalescekey == entry.coalescekey) {
+                queue.frames[i].frame = entry.frame;
+                return;
+            }
+        }
+    }
+    queue.frames.append(entry);
+    dispatch();
+}
+
+void FSendQueue::clear() {
+    timer.stop();
+    for (int i = 0; i < SEND_CLASS_COUNT; i++) {
+        queues[i].frames.clear();
+    }
+}
+
+int FSendQueue::pending() {
+    int count = 0;
+    for (int i = 0; i < SEND_CLASS_COUNT; i++) {
+        count += queues[i].frames.size();
+    }
+    return count;
+}
+
+qint64 FSendQueue::advertisementDelay(QString channel) {
+    const Queue &queue = queues[SEND_ADVERTISEMENT];
+    qint64 now = clock.elapsed();
+    qint64 delay = qMax<qint64>(queue.targetready.value(channel, 0) - now, 0);
+    foreach (const Frame &frame, queue.frames) {
+        if (frame.target == channel) {
+            delay += queue.targetinterval;
+        }
+    }
+    return delay;
+}
+
+void FSendQueue::refill(Bucket &bucket, qint64 now) {
+    if (bucket.interval <= 0) {
+        bucket.tokens = bucket.capacity;
+    } else {
+        bucket.tokens = qMin(bucket.capacity, bucket.tokens + double(now - bucket.updated) / bucket.interval);
+    }
+    bucket.updated = now;
+}
+
+// Forget the cooldowns that have run out, so channels advertised in once don't stay in 'targetready' for the whole session.
+void FSendQueue::pruneTargets(Queue &queue, qint64 now) {
+    for (QHash<QString, qint64>::iterator it = queue.targetready.begin(); it != queue.targetready.end();) {
+        if (*it <= now) {
+            it = queue.targetready.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FSendQueue::dispatch() {
+    qint64 now = clock.elapsed();
+    qint64 wait = -1;
+    refill(unlimited, now);
+    refill(msgflood, now);
+    refill(typing, now);
+    for (int c = 0; c < SEND_CLASS_COUNT; c++) {
+        Queue &queue = queues[c];
+        Bucket &bucket = *queue.bucket;
+        pruneTargets(queue, now);
+        int i = 0;
+        while (i < queue.frames.size()) {
+            if (bucket.tokens < 1.0) {
+                qint64 refilled = qint64(std::ceil((1.0 - bucket.tokens) * bucket.interval));
+                wait = wait < 0 ? refilled : qMin(wait, refilled);
+                break;
+            }
+            const QString &target = queue.frames.at(i).target;
+            if (!target.isEmpty() && queue.targetready.value(target, 0) > now) {
+                // Leave it in place so frames for the same target keep their order, but let others past.
+                qint64 ready = queue.targetready.value(target) - now;
+                wait = wait < 0 ? ready : qMin(wait, ready);
+                i++;
+                continue;
+            }
+            Frame frame = queue.frames.takeAt(i);
+            if (bucket.interval > 0) {
+                bucket.tokens -= 1.0;
+            }
+            if (!frame.target.isEmpty() && queue.targetinterval > 0) {
+                queue.targetready[frame.target] = now + queue.targetinterval;
+            }
+            emit send(frame.frame);
+        }
+    }
+    if (wait >= 0) {
+        timer.start(qMax<qint64>(wait, 1));
+    } else {
+        timer.stop();
+    }
+}
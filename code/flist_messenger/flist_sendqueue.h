@@ -0,0 +1,95 @@
+#ifndef FLIST_SENDQUEUE_H
+#define FLIST_SENDQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "flist_jsonwriter.h"
+
+// Paces outbound frames so the client stays within the flood limits the
+// server advertises through VAR.
+//
+// Each class of traffic has its own queue, drawing on a token bucket for
+// the server limit it falls under. MSG, PRI and LRP all count against the
+// one msg_flood limit, so those classes share a bucket. Classes are listed
+// in priority order: whenever several frames may go out at once the higher
+// priority ones go first. TPN only carries the latest state, so a TPN for
+// a character replaces an older one still waiting in the queue instead of
+// queuing behind it. Advertisements additionally wait out the per-channel
+// lfrp_flood cooldown.
+class FSendQueue : public QObject {
+        Q_OBJECT
+    public:
+        enum SendClass {
+            SEND_CONTROL,       //< Everything the server does not rate limit. Never delayed.
+            SEND_CHAT,          //< MSG and channel RLL.
+            SEND_PRIVATE,       //< PRI and private RLL.
+            SEND_TYPING,        //< TPN.
+            SEND_ADVERTISEMENT, //< LRP.
+            SEND_CLASS_COUNT
+        };
+
+        static const int DefaultFloodInterval = 500;
+        static const int DefaultAdvertisementInterval = 600000;
+        static const int TypingInterval = 500;
+        static const int TypingBurst = 2;
+        // Allowance for frames that leave evenly spaced arriving slightly bunched up.
+        static const int SafetyMargin = 50;
+
+        explicit FSendQueue(QObject *parent = nullptr);
+
+        // Queue a finished command. Its command and fields decide its class and whether it supersedes a waiting frame.
+        void enqueue(const FJsonWriter &command);
+        // Pick up the limits from the server variables. Safe to call again as more variables arrive.
+        void configure(const QHash<QString, QString> &servervariables);
+        void clear();
+        int pending();
+        // Milliseconds before an advertisement queued now for 'channel' would go out, counting the ones already waiting for it.
+        qint64 advertisementDelay(QString channel);
+
+    signals:
+        void send(QString frame);
+
+    private slots:
+        void dispatch();
+
+    private:
+        class Frame {
+            public:
+                QString frame;
+                QString coalescekey;
+                QString target;
+        };
+        class Bucket {
+            public:
+                Bucket() : tokens(1.0), capacity(1.0), interval(0), updated(0) {}
+                double tokens;
+                double capacity;
+                qint64 interval; //< Milliseconds per token, 0 for no limit.
+                qint64 updated;
+        };
+        class Queue {
+            public:
+                Queue() : bucket(nullptr), targetinterval(0) {}
+                Bucket *bucket;
+                qint64 targetinterval; //< Minimum time between frames to the same target, 0 for no limit.
+                QHash<QString, qint64> targetready;
+                QList<Frame> frames;
+        };
+
+        void refill(Bucket &bucket, qint64 now);
+        void pruneTargets(Queue &queue, qint64 now);
+
+        Bucket unlimited;
+        Bucket msgflood; //< Shared by MSG, PRI, RLL and LRP.
+        Bucket typing;
+        Queue queues[SEND_CLASS_COUNT];
+        QTimer timer;
+        QElapsedTimer clock;
+};
+
+#endif // FLIST_SENDQUEUE_H
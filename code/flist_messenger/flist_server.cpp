@@ -2,7 +2,6 @@
 
 #include "flist_global.h"
 #include "flist_account.h"
-#include "flist_character.h"
 
 FServer::FServer(QObject *parent) :
 	QObject(parent),
@@ -12,6 +11,12 @@ FServer::FServer(QObject *parent) :
 {
 }
 
+FServer::~FServer()
+{
+	// The sessions detach from the character directory, so they have to go before it does.
+	qDeleteAll(accounts);
+}
+
 FAccount *FServer::addAccount()
 {
 	FAccount *account = new FAccount(this, this);
@@ -30,24 +35,3 @@ FSession *FServer::getSession(QString sessionid)
 	}
 	return 0;
 }
-
-FCharacter *characterAdd(QString &name)
-{
-	
-	//todo: Check if character is already in cache.
-	(void) name;
-	return 0;
-}
-
-FCharacter *characterGet(QString &name)
-{
-	//todo: Check if character is already in cache.
-    (void) name;
-    return 0;
-}
-
-void characterRemove(QString &name)
-{
-	//todo: Iterate over open accounts and sessions and see if the character is still refered to.
-    (void) name;
-}
@@ -5,6 +5,8 @@
 #include <QHash>
 #include <QString>
 
+#include "flist_characterdirectory.h"
+
 class FAccount;
 class FCharacter;
 class FSession;
@@ -13,6 +15,7 @@ class FServer : public QObject {
         Q_OBJECT
     public:
         explicit FServer(QObject *parent = 0);
+        ~FServer();
         FAccount *addAccount();
         FSession *getSession(QString sessionid);
 
@@ -24,8 +27,8 @@ class FServer : public QObject {
         QString chatserver_host;
         QString chatserver_port;
 
-        QList<FAccount *> accounts; //< User accounts that are logged on. (Should only be one.)
-                                    // QHash<QString, FCharacterProfile *> charactercache; //< List of all known characters on the server.
+        QList<FAccount *> accounts;     //< User accounts that are logged on. (Should only be one.)
+        FCharacterDirectory characters; //< Characters online, shared by every session on this server.
 };
 
 #endif                              // FSERVER_H
@@ -1,5 +1,8 @@
 
 #include <QTime>
+#include <QRandomGenerator>
+#include <QElapsedTimer>
+#include <QStringBuilder>
 #include <QSslSocket>
 #include <QtWebSockets/QWebSocket>
 
@@ -8,11 +11,13 @@
 #include "flist_global.h"
 #include "flist_server.h"
 #include "flist_character.h"
+#include "flist_characterdirectory.h"
 #include "flist_iuserinterface.h"
-#include "flist_jsonhelper.h"
+#include "flist_jsonwriter.h"
 #include "flist_channel.h"
 #include "flist_parser.h"
 #include "flist_message.h"
+#include "flist_sendqueue.h"
 
 FSession::FSession(FAccount *account, QString &character, QObject *parent)
     : QObject(parent),
@@ -20,7 +25,8 @@ FSession::FSession(FAccount *account, QString &character, QObject *parent)
       account(account),
       sessionid(character),
       character(character),
-      characterlist(),
+      characters(&account->server->characters),
+      directoryslot(characters->attach()),
       friendslist(),
       bookmarklist(),
       operatorlist(),
@@ -30,71 +36,90 @@ FSession::FSession(FAccount *account, QString &character, QObject *parent)
       servervariables(),
       knownchannellist(),
       knownopenroomlist(),
+      sendqueue(new FSendQueue(this)),
       wsready(false),
       socketreadbuffer() {
-    // create socket right away
-    m_socket = new FSocket(account->server->chatserver_host + account->server->chatserver_port, this);
+    // create socket right away, on its own thread so network traffic and frame decoding never wait on the GUI
+    m_socket = new FSocket(account->server->chatserver_host + account->server->chatserver_port);
+    m_socket->moveToThread(&networkthread);
+    connect(&networkthread, SIGNAL(finished()), m_socket, SLOT(deleteLater()));
+    networkthread.setObjectName(QString("Network %1").arg(character));
+    networkthread.start();
 
     // connect socket signals
     connect(m_socket, SIGNAL(socketConnected()), this, SLOT(socketConnected()));
-    connect(m_socket, SIGNAL(socketReceived(QString)), this, SLOT(socketReceived(QString)));
+    connect(m_socket, SIGNAL(framesReady()), this, SLOT(framesReady()));
     connect(m_socket, SIGNAL(socketSSLErrors(QString)), this, SLOT(socketSslError(QString)));
     connect(m_socket, SIGNAL(socketError(QString)), this, SLOT(socketError(QString)));
+    connect(sendqueue, SIGNAL(send(QString)), this, SLOT(sendQueued(QString)));
+
+    draintimer.setSingleShot(true);
+    draintimer.setInterval(FrameInterval);
+    connect(&draintimer, SIGNAL(timeout()), this, SLOT(drainFrames()));
+
+    reconnecttimer.setSingleShot(true);
+    connect(&reconnecttimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+    resynctimer.setSingleShot(true);
+    resynctimer.setInterval(ResyncSettleDelay);
+    connect(&resynctimer, SIGNAL(timeout()), this, SLOT(finishResync()));
+    connect(account, SIGNAL(ticketReady(FAccount *, QString)), this, SLOT(ticketRefreshed(FAccount *, QString)));
+    connect(account, SIGNAL(ticketFailed(FAccount *, QString)), this, SLOT(ticketRefreshFailed(FAccount *, QString)));
 }
 
 FSession::~FSession() {
-    if (m_socket != nullptr) {
-        delete m_socket;
-    }
+    // The socket is deleted on its own thread once the thread's event loop has stopped.
+    networkthread.quit();
+    networkthread.wait();
+    characters->detach(directoryslot);
+}
+
+bool FSession::isCharacterOnline(QString name) {
+    return characters->isOnline(directoryslot, name);
+}
+
+FCharacter *FSession::getCharacter(QString name) {
+    return characters->get(directoryslot, name);
+}
+
+int FSession::getCharacterCount() {
+    return characters->count(directoryslot);
 }
 
 FCharacter *FSession::addCharacter(QString name) {
-    FCharacter *character = getCharacter(name);
-    if (!character) {
-        character = new FCharacter(name, friendslist.contains(name));
-        characterlist[name] = character;
-    }
-    return character;
+    return characters->add(directoryslot, name);
 }
 
 void FSession::removeCharacter(QString name) {
-    // Get and remove the character from the list.
-    FCharacter *character = characterlist.take(name);
-    // Delete if not null.
-    if (character) {
-        delete character;
-    }
+    // The character itself stays for as long as another session still has it online.
+    characters->remove(directoryslot, name);
 }
 
 /**
 Convert a character's name into a formated hyperlinked HTML text. It will use the correct colors if they're known.
  */
 QString FSession::getCharacterHtml(QString name) {
-    QString html = "<b><a style=\"color: %1\" href=\"%2\">%3</a></b>";
     FCharacter *character = getCharacter(name);
     if (character) {
-        html = html.arg(character->genderColor().name()).arg(character->getUrl()).arg(name);
-    } else {
-        html = html.arg(FCharacter::genderColors[FCharacter::GENDER_OFFLINE_UNKNOWN].name()).arg(getCharacterUrl(name)).arg(name);
+        return character->nameHtml(FCharacter::NAMEHTML_NORMAL) + "</a></b>";
     }
-    return html;
+    return FCharacter::buildNameHtml(FCharacter::genderColors[FCharacter::GENDER_OFFLINE_UNKNOWN], getCharacterUrl(name), FCharacter::NAMEHTML_NORMAL, name) + "</a></b>";
 }
 
 /**
 Tell the server that we wish to join the given channel.
  */
 void FSession::joinChannel(QString name) {
-    wsSend(generateJsonCommandWithKeyValue("JCH", "channel", name).toStdString().c_str());
+    wsSend(FJsonWriter("JCH").field("channel", name));
 }
 
 void FSession::createPublicChannel(QString name) {
     // [0:59 AM]>>CRC {"channel":"test"}
-    wsSend(generateJsonCommandWithKeyValue("CRC", "channel", name).toStdString().c_str());
+    wsSend(FJsonWriter("CRC").field("channel", name));
 }
 
 void FSession::createPrivateChannel(QString name) {
     // [17:24 PM]>>CCR {"channel":"abc"}
-    wsSend(generateJsonCommandWithKeyValue("CCR", "channel", name).toStdString().c_str());
+    wsSend(FJsonWriter("CCR").field("channel", name));
 }
 
 FChannel *FSession::addChannel(QString name, QString title) {
@@ -127,7 +152,7 @@ void FSession::connectSession() {
     wsready = false;
 
     debugMessage("Connecting...");
-    m_socket->socketConnect();
+    QMetaObject::invokeMethod(m_socket, "socketConnect", Qt::QueuedConnection);
 }
 
 void FSession::socketConnected() {
@@ -136,25 +161,102 @@ void FSession::socketConnected() {
     connected = true;
     connectionAttempt = false;
 
-    FJsonHelper helper;
-
-    QMap<QString, QString> valueMap;
-    valueMap.insert("method", "ticket");
-    valueMap.insert("ticket", account->ticket);
-    valueMap.insert("account", account->getUserName());
-    valueMap.insert("cname", FLIST_CLIENTID);
-    valueMap.insert("cversion", FLIST_VERSIONNUM);
-    valueMap.insert("character", character);
-    QJsonDocument loginNode = helper.generateJsonNodesFromMap(valueMap);
+    if (reconnecting) {
+        // Keep everything from before the drop and reconcile it with what the server sends, instead of starting from scratch.
+        resyncing = true;
+        pendingrejoins.clear();
+        QStringList known = characters->names(directoryslot);
+        stalecharacters = QSet<QString>(known.begin(), known.end());
+    }
+    sendIdentify();
+}
 
-    std::string idenStr = "IDN " + loginNode.toJson(QJsonDocument::Compact).toStdString();
+void FSession::sendIdentify() {
+    FJsonWriter command("IDN");
+    command.field("method", "ticket");
+    command.field("ticket", account->ticket);
+    command.field("account", account->getUserName());
+    command.field("cname", FLIST_CLIENTID);
+    command.field("cversion", FLIST_VERSIONNUM);
+    command.field("character", character);
     debugMessage("Identify...");
-    wsSend(idenStr);
+    wsSend(command);
 }
 
 void FSession::socketError(QString error) {
+    // Whatever arrived before the error still belongs to the session.
+    receiveFrames(false);
     connected = false;
+    connectionAttempt = false;
+    // Anything still waiting was meant for the old connection.
+    sendqueue->clear();
+    resynctimer.stop();
     emit socketErrorSignal(error);
+    scheduleReconnect();
+}
+
+/**
+Wait out the next backoff delay, then reconnect with a fresh ticket.
+ */
+void FSession::scheduleReconnect() {
+    if (!reconnectallowed) {
+        account->ui->messageSystem(this, "Not reconnecting automatically.", MESSAGE_TYPE_ERROR);
+        return;
+    }
+    reconnecting = true;
+    int delay = ReconnectMaxDelay;
+    if (reconnectattempts < 16) {
+        delay = qMin(ReconnectMaxDelay, ReconnectBaseDelay << reconnectattempts);
+    }
+    delay = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    reconnectattempts++;
+    account->ui->messageSystem(this, QString("Connection lost. Reconnecting in %1 seconds.").arg((delay + 999) / 1000), MESSAGE_TYPE_SYSTEM);
+    reconnecttimer.start(delay);
+}
+
+void FSession::reconnect() {
+    debugMessage("Reconnecting, requesting a new ticket...");
+    account->refreshTicket();
+}
+
+void FSession::ticketRefreshed(FAccount *account, QString ticket) {
+    (void)account;
+    (void)ticket;
+    // Another session may have asked for this ticket while this one is still waiting out its delay.
+    if (!reconnecting || connected || connectionAttempt || reconnecttimer.isActive()) {
+        return;
+    }
+    connectSession();
+}
+
+void FSession::ticketRefreshFailed(FAccount *account, QString error) {
+    if (!reconnecting || connected || connectionAttempt || reconnecttimer.isActive()) {
+        return;
+    }
+    account->ui->messageSystem(this, QString("Could not get a new login ticket: %1").arg(error), MESSAGE_TYPE_ERROR);
+    scheduleReconnect();
+}
+
+/**
+Called once the server has gone quiet after listing the online characters. Anyone it did not list went offline while we were away, and any
+channel that was rejoined without an ICH in reply could not be rejoined.
+ */
+void FSession::finishResync() {
+    resyncing = false;
+    foreach (QString charactername, stalecharacters) {
+        if (isCharacterOnline(charactername)) {
+            characterOffline(charactername);
+        }
+    }
+    stalecharacters.clear();
+    foreach (QString channelname, pendingrejoins) {
+        FChannel *channel = getChannel(channelname);
+        if (channel && channel->isJoined()) {
+            account->ui->messageSystem(this, QString("Could not rejoin '%1' after reconnecting.").arg(channel->getTitle()), MESSAGE_TYPE_ERROR);
+            channel->leave();
+        }
+    }
+    pendingrejoins.clear();
 }
 
 void FSession::socketSslError(QString sslerrors) {
@@ -169,28 +271,43 @@ void FSession::socketSslError(QString sslerrors) {
     emit socketSSLErrorSignal(sslerrors);
 }
 
-void FSession::socketReceived(QString message) {
-    wsRecv(message.toStdString());
+void FSession::framesReady() {
+    // The socket only signals when its queue goes from empty to non-empty, so handle that right away. A running timer means a backlog is already being worked through.
+    if (!draintimer.isActive()) {
+        receiveFrames(true);
+    }
 }
 
-QString FSession::generateJsonCommandWithKeyValue(QString command, QString key, QString value) {
-    FJsonHelper helper;
-    QString result;
-
-    QJsonDocument resultNode = helper.generateJsonNodeWithKeyValue(key, value);
-    result = command + " " + resultNode.toJson();
+void FSession::drainFrames() {
+    receiveFrames(true);
+}
 
-    return result;
+/**
+Handle the frames the network thread has decoded. When 'budgeted' it stops after FrameBudget and picks up the rest on the next frame interval.
+ */
+void FSession::receiveFrames(bool budgeted) {
+    QElapsedTimer budget;
+    budget.start();
+    FServerFrame frame;
+    while (m_socket->takeFrame(frame)) {
+        dispatchFrame(frame);
+        if (budgeted && budget.elapsed() >= FrameBudget) {
+            draintimer.start();
+            return;
+        }
+    }
 }
 
 void FSession::wsSend(const char *command) {
-    std::string cmd = command;
-    wsSend(cmd);
+    wsSend(FJsonWriter(command));
 }
 
-void FSession::wsSend(const char *command, QJsonDocument &nodes) {
-    std::string cmd = command + (" " + nodes.toJson().toStdString());
-    wsSend(cmd);
+void FSession::wsSend(const FJsonWriter &command) {
+    if (!connected) {
+        debugMessage("Attempted to send a message, but socket is not connected.");
+        return;
+    }
+    sendqueue->enqueue(command);
 }
 
 void FSession::wsSend(std::string &input) {
@@ -199,21 +316,30 @@ void FSession::wsSend(std::string &input) {
         debugMessage("Attempted to send a message, but socket is not connected.");
     } else {
         fix_broken_escaped_apos(input);
-        // debugMessage(">>" + input);
-        m_socket->send(QString::fromStdString(input));
+        // Raw frames have no parsed fields, so only the command decides how they are paced.
+        sendqueue->enqueue(FJsonWriter::fromFrame(QString::fromStdString(input)));
     }
 }
 
+void FSession::sendQueued(QString frame) {
+    if (!connected) {
+        return;
+    }
+    // debugMessage(">>" + frame);
+    QMetaObject::invokeMethod(m_socket, "send", Qt::QueuedConnection, Q_ARG(QString, frame));
+}
+
 void FSession::wsRecv(std::string packet) {
+    FServerFrame frame = FSocket::decodeFrame(QString::fromStdString(packet));
+    dispatchFrame(frame);
+}
+
+void FSession::dispatchFrame(FServerFrame &frame) {
+    std::string &packet = frame.raw;
     // debugMessage("<<" + packet);
     try {
-        std::string cmd = packet.substr(0, 3);
-        QJsonDocument nodes;
-        QVariantMap nodeMap;
-        if (packet.length() > 4) {
-            nodes = nodes.fromJson(packet.substr(4, packet.length() - 4).c_str());
-            nodeMap = nodes.toVariant().toMap();
-        }
+        std::string &cmd = frame.command;
+        QVariantMap &nodeMap = frame.fields;
 #define CMD(name)                   \
     if (cmd == #name) {             \
         cmd##name(packet, nodeMap); \
@@ -298,13 +424,30 @@ COMMAND(ADL) {
     QStringList childnode = nodes.value("ops").toStringList();
     int size = childnode.size();
 
+    if (resyncing) {
+        // The list is complete, so anyone it no longer names lost their status while we were away.
+        QSet<QString> listed;
+        foreach (QString op, childnode) {
+            listed.insert(op.toLower());
+        }
+        foreach (QString op, operatorlist.values()) {
+            if (listed.contains(op.toLower())) {
+                continue;
+            }
+            operatorlist.remove(op.toLower());
+            if (isCharacterOnline(op)) {
+                getCharacter(op)->setIsChatOp(false);
+            }
+            account->ui->setChatOperator(this, op, false);
+        }
+    }
     for (int i = 0; i < size; ++i) {
         QString op = childnode[i];
         operatorlist[op.toLower()] = op;
 
         if (isCharacterOnline(op)) {
             // Set flag in character
-            FCharacter *character = characterlist[op];
+            FCharacter *character = getCharacter(op);
             character->setIsChatOp(true);
         }
         account->ui->setChatOperator(this, op, true);
@@ -320,7 +463,7 @@ COMMAND(AOP) {
 
     if (isCharacterOnline(op)) {
         // Set flag in character
-        FCharacter *character = characterlist[op];
+        FCharacter *character = getCharacter(op);
         character->setIsChatOp(true);
     }
     account->ui->setChatOperator(this, op, true);
@@ -335,7 +478,7 @@ COMMAND(DOP) {
 
     if (isCharacterOnline(op)) {
         // Set flag in character
-        FCharacter *character = characterlist[op];
+        FCharacter *character = getCharacter(op);
         character->setIsChatOp(false);
     }
     account->ui->setChatOperator(this, op, false);
@@ -470,6 +613,9 @@ COMMAND(ICH) {
     }
     account->ui->setChannelMode(this, channelname, channel->mode);
 
+    // When rejoining after a reconnect the channel still holds its old user list. Only the differences get applied, and announced, so the panel isn't rebuilt.
+    bool rejoined = pendingrejoins.remove(channelname);
+    QSet<QString> present;
     int size = childnode.size();
     debugMessage("Initial channel data for '" + channelname + "', charcter count: " + QString::number(size));
     for (int i = 0; i < size; i++) {
@@ -479,10 +625,24 @@ COMMAND(ICH) {
             debugMessage("[SERVER BUG] Server gave us a character in the channel user list that we don't know about yet: " + charactername.toStdString() + ", " + rawpacket);
             continue;
         }
-        // debugMessage("Add character '" + charactername + "' to channel '" + channelname + "'.");
-        channel->addCharacter(charactername, false);
+        present.insert(charactername.toLower());
+        if (!channel->isCharacterPresent(charactername)) {
+            // debugMessage("Add character '" + charactername + "' to channel '" + channelname + "'.");
+            channel->addCharacter(charactername, rejoined);
+        }
+    }
+    if (rejoined) {
+        foreach (QString charactername, channel->getCharacterNames()) {
+            if (!present.contains(charactername.toLower()) && charactername != character) {
+                channel->removeCharacter(charactername);
+            }
+        }
     }
     account->ui->notifyChannelReady(this, channelname);
+    if (resyncing) {
+        // Other rejoins may still be on their way.
+        resynctimer.start();
+    }
 }
 
 COMMAND(JCH) {
@@ -501,6 +661,10 @@ COMMAND(JCH) {
     }
     channel = addChannel(channelname, channeltitle);
     account->ui->addChannel(this, channelname, channeltitle);
+    if (charactername == character && channel->isJoined() && channel->isCharacterPresent(charactername)) {
+        // Rejoining after a reconnect; as far as the panel is concerned we never left.
+        return;
+    }
     channel->addCharacter(charactername, true);
     if (charactername == character) {
         channel->join();
@@ -566,13 +730,17 @@ COMMAND(NLN) {
     QString charactername = nodes.value("identity").toString();
     QString gender = nodes.value("gender").toString();
     QString status = nodes.value("status").toString();
+    bool known = isCharacterOnline(charactername);
+    stalecharacters.remove(charactername);
     FCharacter *character = addCharacter(charactername);
     character->setGender(gender);
     character->setStatus(status);
     if (operatorlist.contains(charactername.toLower())) {
         character->setIsChatOp(true);
     }
-    emit notifyCharacterOnline(this, charactername, true);
+    if (!known) {
+        emit notifyCharacterOnline(this, charactername, true);
+    }
 }
 
 COMMAND(LIS) {
@@ -595,15 +763,27 @@ COMMAND(LIS) {
         // debugMessage("status: " + status);
         QString statusmessage = characternode.at(3).toString();
         // debugMessage("statusmessage: " + statusmessage);
+        // After a reconnect most of the list is already known; only announce what actually changed.
+        bool known = isCharacterOnline(charactername);
+        stalecharacters.remove(charactername);
         FCharacter *character;
         character = addCharacter(charactername);
+        FCharacter::characterStatus oldstatus = character->status();
+        QString oldstatusmessage = character->statusMsg();
         character->setGender(gender);
         character->setStatus(status);
         character->setStatusMsg(statusmessage);
         if (operatorlist.contains(charactername.toLower())) {
             character->setIsChatOp(true);
         }
-        emit notifyCharacterOnline(this, charactername, true);
+        if (!known) {
+            emit notifyCharacterOnline(this, charactername, true);
+        } else if (character->status() != oldstatus || character->statusMsg() != oldstatusmessage) {
+            emit notifyCharacterStatusUpdate(this, charactername);
+        }
+    }
+    if (resyncing) {
+        resynctimer.start();
     }
 }
 
@@ -616,6 +796,10 @@ COMMAND(FLN) {
         debugMessage("[SERVER BUG] Received offline message for '" + charactername + "' but they're not listed as being online.");
         return;
     }
+    characterOffline(charactername);
+}
+
+void FSession::characterOffline(QString charactername) {
     // Iterate over all channels and make the chracacter leave them if they're present.
     for (QHash<QString, FChannel *>::const_iterator iter = channellist.begin(); iter != channellist.end(); iter++) {
         if ((*iter)->isCharacterPresent(charactername)) {
@@ -840,8 +1024,19 @@ COMMAND(HLO) {
     // HLO {"message": "Server Message"}
     QString message = nodes.value("message").toString();
     account->ui->messageSystem(this, QString("<b>%1</b>").arg(message), MESSAGE_TYPE_LOGIN);
-    foreach (QString channelname, autojoinchannels) {
-        joinChannel(channelname);
+    if (resyncing) {
+        // Go back to whatever was open when the connection dropped, not to the autojoin list.
+        foreach (FChannel *channel, channellist) {
+            if (channel->isJoined()) {
+                pendingrejoins.insert(channel->name);
+                joinChannel(channel->name);
+            }
+        }
+        resynctimer.start();
+    } else {
+        foreach (QString channelname, autojoinchannels) {
+            joinChannel(channelname);
+        }
     }
 }
 
@@ -856,6 +1051,9 @@ COMMAND(IDN) {
         debugMessage(
                 QString("[SERVER BUG] Received IDN response for '%1', but this session is for '%2'. %3").arg(charactername).arg(character).arg(QString::fromStdString(rawpacket)));
     }
+    reconnecting = false;
+    reconnectattempts = 0;
+    emit identified(this);
 
     requestServerUptime();
 }
@@ -868,6 +1066,7 @@ COMMAND(VAR) {
     QString variable = nodes.value("variable").toString();
     servervariables[variable] = value;
     debugMessage(QString("Server variable: %1 = '%2'").arg(variable).arg(value));
+    sendqueue->configure(servervariables);
     // todo: Parse and store variables of interest.
 }
 
@@ -878,6 +1077,10 @@ COMMAND(FRL) {
     qDebug() << "FRL ->" << nodes;
     QStringList childnode = nodes.value("characters").toStringList();
     int size = childnode.size();
+    if (resyncing) {
+        // A complete list, which replaces whatever was known before the reconnect.
+        friendslist.clear();
+    }
     for (int i = 0; i < size; i++) {
         QString charactername = childnode.at(i);
         if (!friendslist.contains(charactername)) {
@@ -930,54 +1133,39 @@ COMMAND(IGN) {
 }
 
 QString FSession::makeMessage(QString message, QString charactername, FCharacter *character, FChannel *channel, QString prefix, QString postfix) {
-    QString characterprefix;
-    QString characterpostfix;
+    FCharacter::nameHtmlVariant variant = FCharacter::NAMEHTML_NORMAL;
     if (isCharacterOperator(charactername)) {
-        // todo: choose a different icon
-        characterprefix += "<img src=\":/images/auction-hammer.png\" />";
-    }
-    if (isCharacterOperator(charactername) || (channel && channel->isCharacterOperator(charactername))) {
-        characterprefix += "<img src=\":/images/auction-hammer.png\" />";
+        variant = FCharacter::NAMEHTML_CHATOP;
+    } else if (channel && channel->isCharacterOperator(charactername)) {
+        variant = FCharacter::NAMEHTML_CHANNELOP;
     }
+    bool emote = message.startsWith("/me");
+    QLatin1String characterpostfix("");
     QString messagebody;
     if (message.startsWith("/me 's ")) {
         messagebody = message.mid(7, -1);
         messagebody = bbcodeparser->parse(messagebody);
-        characterpostfix += "'s"; // todo: HTML escape
+        characterpostfix = QLatin1String("'s"); // todo: HTML escape
     } else if (message.startsWith("/me ")) {
         messagebody = message.mid(4, -1);
         messagebody = bbcodeparser->parse(messagebody);
     } else if (message.startsWith("/warn ")) {
         messagebody = message.mid(6, -1);
-        messagebody = QString("<span id=\"warning\">%1</span>").arg(bbcodeparser->parse(messagebody));
+        messagebody = QLatin1String("<span id=\"warning\">") % bbcodeparser->parse(messagebody) % QLatin1String("</span>");
     } else {
         messagebody = bbcodeparser->parse(message);
     }
-    QString messagefinal;
-    if (character != NULL) {
-        messagefinal = QString("<b><a style=\"color: %1\" href=\"%2\">%3%4%5</a></b> %6")
-                               .arg(character->genderColor().name())
-                               .arg(character->getUrl())
-                               .arg(characterprefix)
-                               .arg(charactername) // todo: HTML escape
-                               .arg(characterpostfix)
-                               .arg(messagebody);
-    } else {
-        messagefinal = QString("<b><a style=\"color: %1\" href=\"%2\">%3%4%5</a></b> %6")
-                               .arg(FCharacter::genderColors[FCharacter::GENDER_OFFLINE_UNKNOWN].name())
-                               .arg(getCharacterUrl(charactername))
-                               .arg(characterprefix)
-                               .arg(charactername) // todo: HTML escape
-                               .arg(characterpostfix)
-                               .arg(messagebody);
-    }
-    if (message.startsWith("/me")) {
-        messagefinal = QString("%1<i>*%2</i>%3").arg(prefix).arg(messagefinal).arg(postfix);
-    } else {
-        messagefinal = QString("%1%2%3").arg(prefix).arg(messagefinal).arg(postfix);
+    QString offlinenamehtml;
+    if (character == NULL) {
+        offlinenamehtml = FCharacter::buildNameHtml(FCharacter::genderColors[FCharacter::GENDER_OFFLINE_UNKNOWN], getCharacterUrl(charactername), variant, charactername);
     }
+    const QString &namehtml = character != NULL ? character->nameHtml(variant) : offlinenamehtml;
 
-    return messagefinal;
+    // Each of these is a single QStringBuilder expression: the length is summed first and every piece is copied once into one buffer.
+    if (emote) {
+        return prefix % QLatin1String("<i>*") % namehtml % characterpostfix % QLatin1String("</a></b> ") % messagebody % QLatin1String("</i>") % postfix;
+    }
+    return prefix % namehtml % characterpostfix % QLatin1String("</a></b> ") % messagebody % postfix;
 }
 
 COMMAND(LRP) {
@@ -1006,7 +1194,7 @@ COMMAND(LRP) {
     }
     QString messagefinal = makeMessage(message, charactername, character, channel, "<font color=\"green\"><b>Roleplay ad by</b></font> ", "");
     FMessage fmessage(messagefinal, MESSAGE_TYPE_RPAD);
-    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(charactername).fromSession(sessionid);
+    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(charactername).fromSession(sessionid).withRawMessage(message);
     account->ui->messageMessage(fmessage);
 }
 
@@ -1036,7 +1224,7 @@ COMMAND(MSG) {
     }
     QString messagefinal = makeMessage(message, charactername, character, channel);
     FMessage fmessage(messagefinal, MESSAGE_TYPE_CHAT);
-    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(charactername).fromSession(sessionid);
+    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(charactername).fromSession(sessionid).withRawMessage(message);
     account->ui->messageMessage(fmessage);
 }
 
@@ -1061,7 +1249,7 @@ COMMAND(PRI) {
     QString messagefinal = makeMessage(message, charactername, character);
     account->ui->addCharacterChat(this, charactername);
     FMessage fmessage(messagefinal, MESSAGE_TYPE_CHAT);
-    fmessage.toCharacter(charactername).fromCharacter(charactername).fromSession(sessionid);
+    fmessage.toCharacter(charactername).fromCharacter(charactername).fromSession(sessionid).withRawMessage(message);
     account->ui->messageMessage(fmessage);
 }
 
@@ -1105,7 +1293,7 @@ COMMAND(RLL) {
         account->ui->addCharacterChat(this, charactername);
         QString messagefinal = bbcodeparser->parse(message);
         FMessage fmessage(messagefinal, MESSAGE_TYPE_ROLL);
-        fmessage.toCharacter(charactername).fromCharacter(this->character).fromSession(sessionid);
+        fmessage.toCharacter(charactername).fromCharacter(this->character).fromSession(sessionid).withRawMessage(message);
         account->ui->messageMessage(fmessage);
     }
 }
@@ -1168,69 +1356,15 @@ COMMAND(UPT) {
 }
 
 COMMAND(KID) {
-    // Custom kink data.
-    // KID {"type": kinkdataenum, "character": "Character Name", ???}
-    // KID {"type": "start", "character": "Character Name", "message": "Custom kinks of Character Name"}
-    // KID {"type": "end", "character": "Character Name", "message": "End of custom kinks."}
-    // KID {"type": "custom", "character": "Character Name", "key": "Key Text", "value": "Value Text"}
-    // Where "kinkdataenum" is one of: "start", "end", "custom"
-    QString type = nodes.value("type").toString();
-    QString charactername = nodes.value("character").toString();
-    FCharacter *character = getCharacter(charactername);
-    if (!character) {
-        debugMessage(QString("[SERVER BUG] Received custom kink data for the character '%1' but the character '%1' is unknown. %2")
-                             .arg(charactername)
-                             .arg(QString::fromStdString(rawpacket)));
-        return;
-    }
-    if (type == "start") {
-        character->clearCustomKinkData();
-        // account->ui->notifyCharacterCustomKinkDataReset(this, charactername);
-    } else if (type == "end") {
-        account->ui->notifyCharacterCustomKinkDataUpdated(this, charactername);
-    } else if (type == "custom") {
-        QString key = nodes.value("key").toString();
-        QString value = nodes.value("value").toString();
-        character->addCustomKinkData(key, value);
-    } else {
-        debugMessage(QString("[BUG] Received custom kink data for the character '%1' with a type of '%2' but we don't know how to handle '%2'. %3")
-                             .arg(charactername)
-                             .arg(QString::fromStdString(rawpacket)));
-    }
+    (void)rawpacket;
+    (void)nodes;
+    // Custom kink data, in answer to KIN. Profiles come from FCharacterProfile over the JSON API now, so KIN is never sent.
 }
 
 COMMAND(PRD) {
-    // Profile data.
-    // PRD {"type": profiledataenum, "character": "Character Name", ???}
-    // PRD {"type": "start", "character": "Character Name", "message": "Profile of Character Name"}
-    // PRD {"type": "end", "character": "Character Name", "message": "End of Profile"}
-    // PRD {"type": "info", "character": "Character Name", "key": "Key Text", "value": "Value Text"}
-    // PRD {"type": "select", "character": "Character Name", ???}
-    // Where "profiledataenum" is one of: "start", "end", "info", "select"
-    QString type = nodes.value("type").toString();
-    QString charactername = nodes.value("character").toString();
-    FCharacter *character = getCharacter(charactername);
-    if (!character) {
-        debugMessage(QString("[SERVER BUG] Received profile data for the character '%1' but the character '%1' is unknown. %2")
-                             .arg(charactername)
-                             .arg(QString::fromStdString(rawpacket)));
-        return;
-    }
-    if (type == "start") {
-        character->clearProfileData();
-        // account->ui->notifyCharacterProfileDataReset(this, charactername);
-    } else if (type == "end") {
-        account->ui->notifyCharacterProfileDataUpdated(this, charactername);
-    } else if (type == "info") {
-        QString key = nodes.value("key").toString();
-        QString value = nodes.value("value").toString();
-        character->addProfileData(key, value);
-    } else {
-        // todo: "select" is referred to in the wiki but no additional detail is given.
-        debugMessage(QString("[BUG] Received profile data for the character '%1' with a type of '%2' but we don't know how to handle '%2'. %3")
-                             .arg(charactername)
-                             .arg(QString::fromStdString(rawpacket)));
-    }
+    (void)rawpacket;
+    (void)nodes;
+    // Profile data, in answer to PRO. Profiles come from FCharacterProfile over the JSON API now, so PRO is never sent.
 }
 
 COMMAND(CHA) {
@@ -1380,8 +1514,6 @@ COMMAND(ERR) {
     // Error message.
     // ERR {"number": error_number, "message": "Error Message"}
 
-    FJsonHelper helper;
-
     QString errornumberstring = nodes.value("number").toString();
     QString errormessage = nodes.value("message").toString();
     QString message = QString("<b>Error %1: </b> %2").arg(errornumberstring).arg(errormessage);
@@ -1399,20 +1531,13 @@ COMMAND(ERR) {
     // todo: Parse the error and pass along to the UI for more informative feedback.
     switch (errornumber) {
         case 34: // Error 34 is not in the wiki, but the existing code sends out another identification if it is received.
-            {
-                QMap<QString, QString> valueMap;
-                valueMap.insert("method", "ticket");
-                valueMap.insert("ticket", account->ticket);
-                valueMap.insert("account", account->getUserName());
-                valueMap.insert("cname", FLIST_CLIENTID);
-                valueMap.insert("cversion", FLIST_VERSIONNUM);
-                valueMap.insert("character", character);
-                QJsonDocument loginNode = helper.generateJsonNodesFromMap(valueMap);
-                std::string idenStr = "IDN " + loginNode.toJson(QJsonDocument::Compact).toStdString();
-                // debugMessage("Indentify...");
-                wsSend(idenStr);
-                break;
-            }
+            sendIdentify();
+            break;
+        case 9:  // Banned from the server.
+        case 31: // The character logged in from somewhere else; reconnecting would just kick that session off.
+        case 33: // Invalid authentication method.
+            reconnectallowed = false;
+            break;
         default:
             break;
     }
@@ -1422,14 +1547,11 @@ COMMAND(PIN) {
     (void)rawpacket;
     (void)nodes;
     // debugMessage("Ping!");
-    std::string cmd = "PIN";
-    wsSend(cmd);
+    wsSend("PIN");
 }
 
 // todo: Lots of duplicated between sendChannelMessage() and sendChannelAdvertisement() that can be refactored into a common function.
 void FSession::sendChannelMessage(QString channelname, QString message) {
-    FJsonHelper helper;
-
     // Confirm channel is known, joined and has the right permissions.
     FChannel *channel = getChannel(channelname);
     if (!channel) {
@@ -1447,23 +1569,21 @@ void FSession::sendChannelMessage(QString channelname, QString message) {
                                    MESSAGE_TYPE_FEEDBACK);
         return;
     }
-    QMap<QString, QString> valueMap;
-    valueMap.insert("channel", channelname);
-    valueMap.insert("message", message);
-    QJsonDocument messageNode = helper.generateJsonNodesFromMap(valueMap);
-    wsSend("MSG", messageNode);
+    FJsonWriter command("MSG");
+    command.field("channel", channelname);
+    command.field("message", message);
+    wsSend(command);
+    QString rawmessage = message;
     // Escape HTML characters.
     message.replace('&', "&amp;").replace('<', "&lt;").replace('>', "&gt;");
     // Send the message to the UI now.
     QString messagefinal = makeMessage(message, character, getCharacter(character), channel);
     FMessage fmessage(messagefinal, MESSAGE_TYPE_CHAT);
-    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(this->character).fromSession(sessionid);
+    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(this->character).fromSession(sessionid).withRawMessage(rawmessage);
     account->ui->messageMessage(fmessage);
 }
 
 void FSession::sendChannelAdvertisement(QString channelname, QString message) {
-    FJsonHelper helper;
-
     // Confirm channel is known, joined and has the right permissions.
     FChannel *channel = getChannel(channelname);
     if (!channel) {
@@ -1481,23 +1601,27 @@ void FSession::sendChannelAdvertisement(QString channelname, QString message) {
                                    MESSAGE_TYPE_FEEDBACK);
         return;
     }
-    QMap<QString, QString> valueMap;
-    valueMap.insert("channel", channelname);
-    valueMap.insert("message", message);
-    QJsonDocument messageNode = helper.generateJsonNodesFromMap(valueMap);
-    wsSend("LRP", messageNode);
+    // The server drops an ad sent within lfrp_flood of the last one, so it waits in the queue; say so rather than leave it looking lost.
+    qint64 delay = sendqueue->advertisementDelay(channelname);
+    if (delay > 0) {
+        account->ui->messageChannel(this, channelname, QString("Your advertisement is queued and will be sent to '%1' in %2 s.").arg(channel->getTitle()).arg((delay + 999) / 1000),
+                                    MESSAGE_TYPE_FEEDBACK);
+    }
+    FJsonWriter command("LRP");
+    command.field("channel", channelname);
+    command.field("message", message);
+    wsSend(command);
+    QString rawmessage = message;
     // Escape HTML characters.
     message.replace('&', "&amp;").replace('<', "&lt;").replace('>', "&gt;");
     // Send the message to the UI now.
     QString messagefinal = makeMessage(message, character, getCharacter(character), channel, "<font color=\"green\"><b>Roleplay ad by</font> ", "");
     FMessage fmessage(messagefinal, MESSAGE_TYPE_RPAD);
-    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(this->character).fromSession(sessionid);
+    fmessage.toChannel(channelname).fromChannel(channelname).fromCharacter(this->character).fromSession(sessionid).withRawMessage(rawmessage);
     account->ui->messageMessage(fmessage);
 }
 
 void FSession::sendCharacterMessage(QString charactername, QString message) {
-    FJsonHelper helper;
-
     // Confirm character is known, online and we are not ignoring them.
     if (!isCharacterOnline(charactername)) {
         account->ui->messageSystem(this, QString("Tried to send a message to '%1' but they are offline or unknown. Message: %2").arg(charactername).arg(message),
@@ -1509,85 +1633,73 @@ void FSession::sendCharacterMessage(QString charactername, QString message) {
         return;
     }
     // Make packet and send it.
-    QMap<QString, QString> valueMap;
-    valueMap.insert("recipient", charactername);
-    valueMap.insert("message", message);
-    QJsonDocument messageNode = helper.generateJsonNodesFromMap(valueMap);
-    wsSend("PRI", messageNode);
+    FJsonWriter command("PRI");
+    command.field("recipient", charactername);
+    command.field("message", message);
+    wsSend(command);
+    QString rawmessage = message;
     // Escape HTML characters.
     // todo: use a proper function
     message.replace('&', "&amp;").replace('<', "&lt;").replace('>', "&gt;");
     // Send the message to the UI now.
     QString messagefinal = makeMessage(message, this->character, getCharacter(this->character));
     FMessage fmessage(messagefinal, MESSAGE_TYPE_CHAT);
-    fmessage.toCharacter(charactername).fromCharacter(this->character).fromSession(sessionid);
+    fmessage.toCharacter(charactername).fromCharacter(this->character).fromSession(sessionid).withRawMessage(rawmessage);
     account->ui->messageMessage(fmessage);
 }
 
 void FSession::sendChannelLeave(QString channelname) {
-    FJsonHelper helper;
-    QJsonDocument nodes = helper.generateJsonNodeWithKeyValue("channel", channelname);
-    wsSend("LCH", nodes);
+    wsSend(FJsonWriter("LCH").field("channel", channelname));
 }
 
 void FSession::sendConfirmStaffReport(QString callid) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
-    valueMap.insert("action", "confirm");
-    valueMap.insert("moderator", character);
-    valueMap.insert("callid", callid);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    FJsonWriter command("SFC");
+    command.field("action", "confirm");
+    command.field("moderator", character);
+    command.field("callid", callid);
 
-    wsSend("SFC", nodes);
+    wsSend(command);
 }
 
 void FSession::sendIgnoreAdd(QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("IGN");
 
     character = character.toLower();
 
-    valueMap.insert("character", character);
-    valueMap.insert("action", "add");
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("action", "add");
 
-    wsSend("IGN", nodes);
+    wsSend(command);
 }
 
 void FSession::sendIgnoreDelete(QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("IGN");
 
     character = character.toLower();
 
-    valueMap.insert("character", character);
-    valueMap.insert("action", "delete");
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("action", "delete");
 
-    wsSend("IGN", nodes);
+    wsSend(command);
 }
 
 void FSession::sendStatus(QString status, QString statusmsg) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("STA");
 
-    valueMap.insert("status", status);
-    valueMap.insert("statusmsg", statusmsg);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("status", status);
+    command.field("statusmsg", statusmsg);
 
-    wsSend("STA", nodes);
+    wsSend(command);
 }
 
 void FSession::sendCharacterTimeout(QString character, int minutes, QString reason) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("TMO");
 
-    valueMap.insert("character", character);
-    valueMap.insert("time", QString::number(minutes));
-    valueMap.insert("reason", reason);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("time", QString::number(minutes));
+    command.field("reason", reason);
 
-    wsSend("TMO", nodes);
+    wsSend(command);
 }
 
 void FSession::sendTypingNotification(QString character, TypingStatus status) {
@@ -1604,246 +1716,183 @@ void FSession::sendTypingNotification(QString character, TypingStatus status) {
             break;
     }
 
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("TPN");
 
-    valueMap.insert("status", statusText);
-    valueMap.insert("character", character);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("status", statusText);
+    command.field("character", character);
 
-    wsSend("TPN", nodes);
+    wsSend(command);
 }
 
 void FSession::sendDebugCommand(QString payload) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("command", payload);
-
-    wsSend("ZZZ", node);
+    wsSend(FJsonWriter("ZZZ").field("command", payload));
 }
 
 void FSession::timeoutFromChannel(QString channel, QString character, int minutes) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CTU");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("character", character);
-    valueMap.insert("length", QString::number(minutes));
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("character", character);
+    command.field("length", QString::number(minutes));
 
-    wsSend("CTU", nodes);
+    wsSend(command);
 }
 
 void FSession::kickFromChannel(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CKU");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("CKU", nodes);
+    wsSend(command);
 }
 
 void FSession::kickFromChat(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("KIK", node);
+    wsSend(FJsonWriter("KIK").field("character", character));
 }
 
 void FSession::banFromChannel(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CBU");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("CBU", nodes);
+    wsSend(command);
 }
 
 void FSession::banFromChat(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("ACB", node);
+    wsSend(FJsonWriter("ACB").field("character", character));
 }
 
 void FSession::unbanFromChannel(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CUB");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("CUB", nodes);
+    wsSend(command);
 }
 
 void FSession::unbanFromChat(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("UNB", node);
+    wsSend(FJsonWriter("UNB").field("character", character));
 }
 
 void FSession::setRoomIsPublic(QString channel, bool isPublic) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("RST");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("status", isPublic ? "public" : "private");
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("status", isPublic ? "public" : "private");
 
-    wsSend("RST", nodes);
+    wsSend(command);
 }
 
 void FSession::inviteToChannel(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CIU");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("CIU", nodes);
+    wsSend(command);
 }
 
 void FSession::giveChanop(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("COA");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("COA", nodes);
+    wsSend(command);
 }
 
 void FSession::takeChanop(QString channel, QString character) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("COR");
 
-    valueMap.insert("character", character);
-    valueMap.insert("channel", channel);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("character", character);
+    command.field("channel", channel);
 
-    wsSend("COR", nodes);
+    wsSend(command);
 }
 
 void FSession::giveGlobalop(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("AOP", node);
+    wsSend(FJsonWriter("AOP").field("character", character));
 }
 
 void FSession::takeGlobalop(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("DOP", node);
+    wsSend(FJsonWriter("DOP").field("character", character));
 }
 
 void FSession::giveReward(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("RWD", node);
+    wsSend(FJsonWriter("RWD").field("character", character));
 }
 
 void FSession::requestChannelBanList(QString channel) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("channel", channel);
-
-    wsSend("CBL", node);
+    wsSend(FJsonWriter("CBL").field("channel", channel));
 }
 
 void FSession::requestChanopList(QString channel) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("channel", channel);
-
-    wsSend("COL", node);
+    wsSend(FJsonWriter("COL").field("channel", channel));
 }
 
 void FSession::killChannel(QString channel) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("channel", channel);
-
-    wsSend("KIC", node);
+    wsSend(FJsonWriter("KIC").field("channel", channel));
 }
 
 void FSession::broadcastMessage(QString message) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("message", message);
-
-    wsSend("BRO", node);
+    wsSend(FJsonWriter("BRO").field("message", message));
 }
 
 void FSession::setChannelDescription(QString channelname, QString description) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CDS");
 
-    valueMap.insert("channel", channelname);
-    valueMap.insert("description", description);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channelname);
+    command.field("description", description);
 
-    wsSend("CDS", nodes);
+    wsSend(command);
 }
 
 void FSession::setChannelMode(QString channel, ChannelMode mode) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("RMO");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("mode", ChannelModeEnum.valueToKey(mode));
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("mode", ChannelModeEnum.valueToKey(mode));
 
-    wsSend("RMO", nodes);
+    wsSend(command);
 }
 
 void FSession::setChannelOwner(QString channel, QString newOwner) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("CSO");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("character", newOwner);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("character", newOwner);
 
-    wsSend("CSO", nodes);
+    wsSend(command);
 }
 
 void FSession::spinBottle(QString channel) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("RLL");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("dice", "bottle");
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("dice", "bottle");
 
-    wsSend("RLL", nodes);
+    wsSend(command);
 }
 
 void FSession::rollDiceChannel(QString channel, QString dice) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("RLL");
 
-    valueMap.insert("channel", channel);
-    valueMap.insert("dice", dice);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("channel", channel);
+    command.field("dice", dice);
 
-    wsSend("RLL", nodes);
+    wsSend(command);
 }
 
 void FSession::rollDicePM(QString recipient, QString dice) {
-    FJsonHelper helper;
-    QMap<QString, QString> valueMap;
+    FJsonWriter command("RLL");
 
-    valueMap.insert("recipient", recipient);
-    valueMap.insert("dice", dice);
-    QJsonDocument nodes = helper.generateJsonNodesFromMap(valueMap);
+    command.field("recipient", recipient);
+    command.field("dice", dice);
 
-    wsSend("RLL", nodes);
+    wsSend(command);
 }
 
 void FSession::requestChannels() {
@@ -1851,14 +1900,6 @@ void FSession::requestChannels() {
     wsSend("ORS");
 }
 
-void FSession::requestProfileKinks(QString character) {
-    FJsonHelper helper;
-    QJsonDocument node = helper.generateJsonNodeWithKeyValue("character", character);
-
-    wsSend("PRO", node);
-    wsSend("KIN", node);
-}
-
 void FSession::requestServerUptime() {
     wsSend("UPT");
 }
@@ -4,9 +4,11 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QSet>
+#include <QTimer>
+#include <QThread>
 #include <QTcpSocket>
 #include <QSslError>
-#include <QJsonDocument>
 
 #include "flist_channelsummary.h"
 #include "flist_enums.h"
@@ -16,11 +18,24 @@
 class FAccount;
 class FChannel;
 class FCharacter;
+class FCharacterDirectory;
+class FJsonWriter;
+class FSendQueue;
 class QSslSocket;
 
 class FSession : public QObject {
         Q_OBJECT
     public:
+        // Reconnect delays double from ReconnectBaseDelay up to ReconnectMaxDelay, each randomised by up to half to spread out clients that dropped together.
+        static const int ReconnectBaseDelay = 1000;
+        static const int ReconnectMaxDelay = 300000;
+        // How long the server gets to go quiet after HLO or the last LIS block before the resync is considered complete.
+        static const int ResyncSettleDelay = 3000;
+        // Incoming frames are handled as soon as they arrive. Once a burst takes longer than FrameBudget, the rest is handled every FrameInterval so it can't stall the window.
+        // Only decoding happens on the network thread; applying frames to the session state still happens here on the GUI thread.
+        static const int FrameInterval = 16;
+        static const int FrameBudget = 8;
+
         explicit FSession(FAccount *account, QString &character, QObject *parent = 0);
         ~FSession();
 
@@ -29,11 +44,11 @@ class FSession : public QObject {
         void connectSession();
 
         void wsSend(const char *command);
-        void wsSend(const char *command, QJsonDocument &nodes);
+        void wsSend(const FJsonWriter &command);
         void wsSend(std::string &data);
         void wsRecv(std::string packet);
 
-        bool isCharacterOnline(QString name) { return characterlist.contains(name); }
+        bool isCharacterOnline(QString name);
 
         bool isCharacterOperator(QString name) { return operatorlist.contains(name); }
 
@@ -43,11 +58,11 @@ class FSession : public QObject {
 
         FCharacter *addCharacter(QString name);
 
-        FCharacter *getCharacter(QString name) { return characterlist.contains(name) ? characterlist[name] : 0; }
+        FCharacter *getCharacter(QString name);
 
         void removeCharacter(QString name);
 
-        int getCharacterCount() { return characterlist.count(); }
+        int getCharacterCount();
 
         QString getCharacterUrl(QString name) {
             return "https://www.f-list.net/c/" + name + "/";
@@ -103,13 +118,13 @@ class FSession : public QObject {
         void rollDiceChannel(QString channel, QString dice);
         void rollDicePM(QString recipient, QString dice);
         void requestChannels();
-        void requestProfileKinks(QString character);
         void requestServerUptime();
 
     signals:
         void socketErrorSignal(QString error);
         void socketSSLErrorSignal(QString error);
         void recvMessage(QString type, QString session, QString chan, QString sender, QString message);
+        void identified(FSession *session); //< The server accepted the identification; sent again after every reconnect.
 
         void notifyCharacterOnline(FSession *session, QString charactername, bool online);
         void notifyCharacterStatusUpdate(FSession *session, QString charactername);
@@ -121,7 +136,15 @@ class FSession : public QObject {
         void socketConnected();
         void socketError(QString error);
         void socketSslError(QString sslerrors);
-        void socketReceived(QString message);
+
+    private slots:
+        void sendQueued(QString frame);
+        void framesReady();
+        void drainFrames();
+        void reconnect();
+        void ticketRefreshed(FAccount *account, QString ticket);
+        void ticketRefreshFailed(FAccount *account, QString error);
+        void finishResync();
 
     public:
         bool connected;
@@ -130,7 +153,8 @@ class FSession : public QObject {
         QString character;
 
     private:
-        QHash<QString, FCharacter *> characterlist; //< List of all known characters on the server/session.
+        FCharacterDirectory *characters;            //< The server's online characters, shared with the other sessions.
+        int directoryslot;                          //< This session's slot in 'characters'.
         QStringList friendslist;                    //<List of friends for this session's character.
         QStringList bookmarklist;                   //<List of friends for this session's character.
         QMap<QString, QString> operatorlist;        //<List of all known characters that are chat operators (indexed by lower case).
@@ -144,11 +168,27 @@ class FSession : public QObject {
         QList<FChannelSummary> knownopenroomlist;   //<List of known open rooms, as reported by the server.
 
     private:
-        FSocket *m_socket = nullptr;
+        FSocket *m_socket = nullptr; //< Lives on networkthread.
+        QThread networkthread;
+        QTimer draintimer;
+        FSendQueue *sendqueue; //< Everything sent goes through here to respect the server's flood limits.
         bool wsready;
         bool connectionAttempt = false;
         std::string socketreadbuffer;
-        QString generateJsonCommandWithKeyValue(QString command, QString key, QString value);
+        void sendIdentify();
+        void receiveFrames(bool budgeted);
+        void dispatchFrame(FServerFrame &frame);
+        void scheduleReconnect();
+        void characterOffline(QString charactername);
+
+        QTimer reconnecttimer;
+        int reconnectattempts = 0;
+        bool reconnecting = false;      //< Set from a lost connection until the server acknowledges the next identification.
+        bool reconnectallowed = true;   //< Cleared by errors that another attempt would only repeat.
+        bool resyncing = false;         //< Set while the state from before the reconnect is being reconciled with the server's.
+        QTimer resynctimer;
+        QSet<QString> stalecharacters;  //< Characters known before the reconnect that the server hasn't listed again yet.
+        QSet<QString> pendingrejoins;   //< Channels rejoined after a reconnect whose ICH hasn't arrived yet.
 
 #define COMMAND(name) void cmd##name(std::string &rawpacket, QVariantMap &nodes)
         COMMAND(ADL);
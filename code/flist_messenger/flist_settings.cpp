@@ -48,9 +48,17 @@ GETSETSTRING(UserAccount, "Global/account", "")
 GETSETSTRING(DefaultChannels, "Global/default_channels", "")
 //Logging
 GETSETBOOL(LogChat, "Global/log_chat", true)
+GETSET(int, toInt, LogCompressAfterDays, "Global/log_compress_after_days", 7)
+GETSET(int, toInt, ScrollbackLines, "Global/scrollback_lines", 100)
 //Show message options
 GETSETBOOL(ShowOnlineOfflineMessage, "Global/show_online_offline", true)
 GETSETBOOL(ShowJoinLeaveMessage, "Global/show_join_leave", true)
 //Sound options
 GETSETBOOL(PlaySounds, "Global/play_sounds", false)
+//Image cache
+GETSET(int, toInt, ImageCacheTtlHours, "Global/image_cache_ttl_hours", 24)
+GETSET(int, toInt, ProfileCacheTtlHours, "Global/profile_cache_ttl_hours", 24)
+//Headless logging
+GETSETSTRING(HeadlessCharacter, "Headless/character", "")
+GETSETSTRING(HeadlessChannels, "Headless/channels", "")
 
@@ -35,11 +35,19 @@ public:
 	PROTOGETSET(DefaultChannels, QString);
 //Logging
 	PROTOGETSET(LogChat, bool);
+	PROTOGETSET(LogCompressAfterDays, int);
+	PROTOGETSET(ScrollbackLines, int);
 //Show message options
 	PROTOGETSET(ShowOnlineOfflineMessage, bool);
 	PROTOGETSET(ShowJoinLeaveMessage, bool);
 //Sound options
 	PROTOGETSET(PlaySounds, bool);
+//Image cache
+	PROTOGETSET(ImageCacheTtlHours, int);
+	PROTOGETSET(ProfileCacheTtlHours, int);
+//Headless logging
+	PROTOGETSET(HeadlessCharacter, QString);
+	PROTOGETSET(HeadlessChannels, QString);
 
 
 #undef PROTOGETSET
@@ -0,0 +1,57 @@
+#ifndef FLIST_SPSCQUEUE_H
+#define FLIST_SPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue for exactly one producer thread and one consumer
+// thread. push() may only be called from the producer and pop() only from
+// the consumer; neither ever blocks the other.
+//
+// The list always holds one spent node at the head, so the producer and the
+// consumer never touch the same node's link at the same time.
+template <typename T> class FSpscQueue {
+    public:
+        FSpscQueue() : head(new Node), tail(head) {}
+
+        ~FSpscQueue() {
+            while (head != nullptr) {
+                Node *next = head->next.load(std::memory_order_relaxed);
+                delete head;
+                head = next;
+            }
+        }
+
+        void push(T value) {
+            Node *node = new Node;
+            node->value = std::move(value);
+            tail->next.store(node, std::memory_order_release);
+            tail = node;
+        }
+
+        bool pop(T &value) {
+            Node *next = head->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return false;
+            }
+            value = std::move(next->value);
+            delete head;
+            head = next;
+            return true;
+        }
+
+    private:
+        FSpscQueue(const FSpscQueue &) = delete;
+        FSpscQueue &operator=(const FSpscQueue &) = delete;
+
+        class Node {
+            public:
+                T value;
+                std::atomic<Node *> next{nullptr};
+        };
+
+        Node *head; //< Consumer side.
+        Node *tail; //< Producer side.
+};
+
+#endif // FLIST_SPSCQUEUE_H
@@ -0,0 +1,71 @@
+#include "flist_typingtracker.h"
+
+#include <QTextDocument>
+
+#include "flist_channelpanel.h"
+
+FTypingTracker::FTypingTracker(QTextDocument *document, QObject *parent)
+    : QObject(parent), document(document), panel(0), desired(TYPING_STATUS_CLEAR) {
+    debounce.setSingleShot(true);
+    debounce.setInterval(DebounceDelay);
+    idletimer.setSingleShot(true);
+    idletimer.setInterval(PauseDelay);
+    connect(&debounce, SIGNAL(timeout()), this, SLOT(flush()));
+    connect(&idletimer, SIGNAL(timeout()), this, SLOT(idle()));
+}
+
+void FTypingTracker::setPanel(FChannelPanel *panel) {
+    if (panel == this->panel) {
+        return;
+    }
+    if (this->panel && desired == TYPING_STATUS_TYPING) {
+        desired = TYPING_STATUS_PAUSED;
+    }
+    flush();
+    idletimer.stop();
+    this->panel = (panel && panel->type() == FChannel::CHANTYPE_PM) ? panel : 0;
+    desired = this->panel ? this->panel->getTypingSelf() : TYPING_STATUS_CLEAR;
+}
+
+bool FTypingTracker::isEmpty() {
+    if (document->isEmpty()) {
+        return true;
+    }
+    if (document->characterCount() > WhitespaceCheckLimit) {
+        return false;
+    }
+    return document->toPlainText().trimmed().isEmpty();
+}
+
+void FTypingTracker::edited() {
+    if (!panel) {
+        return;
+    }
+    if (isEmpty()) {
+        desired = TYPING_STATUS_CLEAR;
+        idletimer.stop();
+    } else {
+        desired = TYPING_STATUS_TYPING;
+        idletimer.start();
+    }
+    // Not restarted on every edit, so steady typing still gets reported promptly.
+    if (!debounce.isActive()) {
+        debounce.start();
+    }
+}
+
+void FTypingTracker::idle() {
+    if (desired == TYPING_STATUS_TYPING) {
+        desired = TYPING_STATUS_PAUSED;
+        flush();
+    }
+}
+
+void FTypingTracker::flush() {
+    debounce.stop();
+    if (!panel || panel->getTypingSelf() == desired) {
+        return;
+    }
+    panel->setTypingSelf(desired);
+    emit typingStatusChanged(panel, desired);
+}
@@ -0,0 +1,53 @@
+#ifndef FLIST_TYPINGTRACKER_H
+#define FLIST_TYPINGTRACKER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "flist_enums.h"
+
+class QTextDocument;
+class FChannelPanel;
+
+// Works out what typing status to report for the PM being written in.
+//
+// Edits only record the status the user should appear to have. It is
+// reported once it has been stable for DebounceDelay, and only if it
+// differs from what the other side was last told, so continuous typing
+// sends a single "typing". After PauseDelay without edits the status drops
+// to "paused" by itself. Whether the input is empty is decided from the
+// document's size, so large drafts are never copied.
+class FTypingTracker : public QObject {
+        Q_OBJECT
+    public:
+        static const int DebounceDelay = 250;
+        static const int PauseDelay = 5000;
+        // Inputs shorter than this are checked for being nothing but whitespace.
+        static const int WhitespaceCheckLimit = 256;
+
+        explicit FTypingTracker(QTextDocument *document, QObject *parent = nullptr);
+
+        // Start tracking 'panel', or stop with 0. Leaving a PM mid-sentence reports it as paused.
+        void setPanel(FChannelPanel *panel);
+
+    public slots:
+        void edited();
+
+    signals:
+        void typingStatusChanged(FChannelPanel *panel, TypingStatus status);
+
+    private slots:
+        void flush();
+        void idle();
+
+    private:
+        bool isEmpty();
+
+        QTextDocument *document;
+        FChannelPanel *panel;
+        TypingStatus desired;
+        QTimer debounce;
+        QTimer idletimer;
+};
+
+#endif // FLIST_TYPINGTRACKER_H
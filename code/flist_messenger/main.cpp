@@ -21,10 +21,35 @@
 
 #include <QApplication>
 #include <QFile>
+#include <QElapsedTimer>
 #include "flist_messenger.h"
 #include "flist_global.h"
+#include "flist_headless.h"
+
+// Log the configured rooms without any interface. No QApplication, so no widget can be created by accident.
+static int runHeadless(int argc, char **argv) {
+    QCoreApplication *app = new QCoreApplication(argc, argv);
+    app->setOrganizationName("F-list.net");
+    app->setOrganizationDomain("www.f-list.net");
+    app->setApplicationName("F-list Messenger");
+    globalInit(true);
+    FCharacter::initClass();
+
+    FHeadlessLogger *logger = new FHeadlessLogger(app);
+    if (!logger->start()) {
+        return 1;
+    }
+    return app->exec();
+}
 
 int main(int argc, char **argv) {
+    QElapsedTimer startup;
+    startup.start();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
     bool d = (argc > 1 && strcmp(argv[1], "-d") == 0) ? true : false;
     QApplication *app = new QApplication(argc, argv);
 #if QT_VERSION >= 0x050000
@@ -53,13 +78,14 @@ int main(int argc, char **argv) {
         QFile::copy(":/stylesheet/colors.ini", "colors.ini");
     }
 
+    // The widget stylesheet is all the login window needs. default.css and colors.ini are only read once the chat window is built.
     QFile stylefile("default.qss");
     stylefile.open(QFile::ReadOnly);
     QString stylesheet = QLatin1String(stylefile.readAll());
 
     app->setStyleSheet(stylesheet);
     flist_messenger::init();
-    flist_messenger *fmessenger = new flist_messenger(d);
+    flist_messenger *fmessenger = new flist_messenger(d, startup);
     fmessenger->show();
     return app->exec();
     // todo: globalQuit();
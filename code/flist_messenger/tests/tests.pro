@@ -0,0 +1,16 @@
+# Unit tests. Build with qmake from this directory and run with 'make check'.
+
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console warn_on
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = tst_escapes
+
+INCLUDEPATH += ..
+
+HEADERS += ../flist_escapes.h
+SOURCES += tst_escapes.cpp \
+           ../flist_escapes.cpp
@@ -0,0 +1,69 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <string>
+
+#include "flist_escapes.h"
+
+// The implementation fix_broken_escaped_apos() replaced, kept as the reference its output is checked against.
+static void reference_fix_broken_escaped_apos(std::string &data) {
+    for (std::string::size_type n = 0; n != data.size(); ++n) {
+        if (is_broken_escaped_apos(data, n)) {
+            data.replace(n, 2, 1, '\'');
+        }
+    }
+}
+
+class TestEscapes : public QObject {
+        Q_OBJECT
+    private slots:
+        void fixed_data();
+        void fixed();
+        void matchesReference();
+};
+
+void TestEscapes::fixed_data() {
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("empty") << "" << "";
+    QTest::newRow("plain") << "no escapes here" << "no escapes here";
+    QTest::newRow("escaped") << "it\\'s" << "it's";
+    QTest::newRow("leading") << "\\'quoted\\'" << "'quoted'";
+    QTest::newRow("trailing backslash") << "path\\" << "path\\";
+    QTest::newRow("lone apostrophe") << "'" << "'";
+    QTest::newRow("double backslash") << "\\\\'" << "\\'";
+    QTest::newRow("repeated") << "\\'\\'\\'" << "'''";
+    QTest::newRow("not rescanned") << "\\\\''" << "\\''";
+}
+
+void TestEscapes::fixed() {
+    QFETCH(QString, input);
+    QFETCH(QString, expected);
+
+    std::string data = input.toStdString();
+    fix_broken_escaped_apos(data);
+    QCOMPARE(QString::fromStdString(data), expected);
+}
+
+void TestEscapes::matchesReference() {
+    // Mostly backslashes and apostrophes, so runs and overlapping matches turn up often.
+    static const char alphabet[] = {'\\', '\\', '\'', '\'', 'a', ' '};
+    QRandomGenerator random(20240229);
+    for (int i = 0; i < 20000; i++) {
+        std::string input;
+        int length = random.bounded(48);
+        for (int j = 0; j < length; j++) {
+            input += alphabet[random.bounded(int(sizeof(alphabet)))];
+        }
+        std::string expected = input;
+        reference_fix_broken_escaped_apos(expected);
+        std::string actual = input;
+        fix_broken_escaped_apos(actual);
+        if (actual != expected) {
+            QFAIL(qPrintable(QString("Mismatch for \"%1\": got \"%2\", expected \"%3\".").arg(QString::fromStdString(input), QString::fromStdString(actual), QString::fromStdString(expected))));
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(TestEscapes)
+#include "tst_escapes.moc"
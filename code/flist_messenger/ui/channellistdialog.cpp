@@ -1,5 +1,7 @@
 #include "ui/channellistdialog.h"
 
+#include <algorithm>
+
 FChannelListModel::FChannelListModel()
 {
 	hash = QIcon ( ":/images/hash.png" );
@@ -13,7 +15,7 @@ FChannelListModel::~FChannelListModel()
 int FChannelListModel::rowCount(const QModelIndex & parent) const
 {
 	if (parent.isValid()) { return 0; }
-	return channels.size() + rooms.size();
+	return channels.rows.size() + rooms.rows.size();
 }
 
 int FChannelListModel::columnCount(const QModelIndex & parent) const
@@ -93,11 +95,257 @@ QVariant FChannelListModel::headerData(int section, Qt::Orientation orientation,
 
 const FChannelSummary &FChannelListModel::byIndex(uint index) const
 {
-	if(index >= rooms.size())
+	return rowByIndex(index).summary;
+}
+
+const FChannelListModel::Row &FChannelListModel::rowByIndex(uint index) const
+{
+	if(index >= rooms.rows.size())
+	{
+		return channels.rows[index - rooms.rows.size()];
+	}
+	return rooms.rows[index];
+}
+
+bool FChannelListModel::matchesFilter(uint index) const
+{
+	return filter.isEmpty() || rowByIndex(index).matched;
+}
+
+void FChannelListModel::merge(List &list, int offset, const std::vector<FChannelSummary> &fresh)
+{
+	std::vector<Row> &rows = list.rows;
+	QHash<QString, int> freshIndex;
+	freshIndex.reserve(fresh.size());
+	for(int i = 0; i < (int)fresh.size(); i++)
+	{
+		freshIndex.insert(fresh[i].name, i);
+	}
+
+	// Drop the rooms that are gone, one run of adjacent rows at a time.
+	// Working from the back keeps the rows not yet looked at where they are.
+	bool moved = false;
+	int end = rows.size();
+	while(end > 0)
+	{
+		if(freshIndex.contains(rows[end - 1].summary.name))
+		{
+			end--;
+			continue;
+		}
+		int begin = end - 1;
+		while(begin > 0 && !freshIndex.contains(rows[begin - 1].summary.name))
+		{
+			begin--;
+		}
+		beginRemoveRows(QModelIndex(), offset + begin, offset + end - 1);
+		for(int i = begin; i < end; i++)
+		{
+			unindexTitle(list, rows[i].summary);
+			list.matches.remove(rows[i].summary.name);
+		}
+		rows.erase(rows.begin() + begin, rows.begin() + end);
+		endRemoveRows();
+		moved = true;
+		end = begin;
+	}
+
+	// Removing rows moved the ones after them.
+	if(moved)
+	{
+		list.positions.clear();
+		for(int i = 0; i < (int)rows.size(); i++)
+		{
+			list.positions.insert(rows[i].summary.name, i);
+		}
+	}
+
+	// Update the ones still there in place; usually only the count moved.
+	std::vector<bool> known(fresh.size(), false);
+	for(int i = 0; i < (int)rows.size(); i++)
+	{
+		int j = freshIndex.value(rows[i].summary.name);
+		known[j] = true;
+		Row &row = rows[i];
+		const FChannelSummary &summary = fresh[j];
+		if(row.summary.count == summary.count && row.summary.title == summary.title && row.summary.type == summary.type)
+		{
+			continue;
+		}
+		if(row.summary.title != summary.title)
+		{
+			unindexTitle(list, row.summary);
+			row.summary.title = summary.title;
+			indexTitle(list, row.summary);
+			setMatched(list, row, titleMatches(row.summary));
+		}
+		row.summary.count = summary.count;
+		row.summary.type = summary.type;
+		emit dataChanged(index(offset + i, 0), index(offset + i, colCount - 1));
+	}
+
+	// And add the new ones at the end. If the server repeats a name, its last entry is the one kept.
+	std::vector<Row> added;
+	for(int i = 0; i < (int)fresh.size(); i++)
+	{
+		if(known[i] || freshIndex.value(fresh[i].name) != i)
+		{
+			continue;
+		}
+		added.push_back(Row(fresh[i]));
+		added.back().matched = titleMatches(fresh[i]);
+	}
+	if(!added.empty())
+	{
+		int first = rows.size();
+		beginInsertRows(QModelIndex(), offset + first, offset + first + added.size() - 1);
+		for(int i = 0; i < (int)added.size(); i++)
+		{
+			indexTitle(list, added[i].summary);
+			list.positions.insert(added[i].summary.name, first + i);
+			if(added[i].matched)
+			{
+				list.matches.insert(added[i].summary.name);
+			}
+		}
+		rows.insert(rows.end(), added.begin(), added.end());
+		endInsertRows();
+	}
+}
+
+QVector<quint64> FChannelListModel::trigrams(const QString &text)
+{
+	QString folded = text.toCaseFolded();
+	QVector<quint64> result;
+	for(int i = 0; i + 3 <= folded.size(); i++)
 	{
-		return channels[index - rooms.size()];
+		result.append(quint64(folded[i].unicode()) << 32 | quint64(folded[i + 1].unicode()) << 16 | folded[i + 2].unicode());
 	}
-	return rooms[index];
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+void FChannelListModel::indexTitle(List &list, const FChannelSummary &summary)
+{
+	foreach(quint64 trigram, trigrams(summary.title))
+	{
+		list.titles[trigram].insert(summary.name);
+	}
+}
+
+void FChannelListModel::unindexTitle(List &list, const FChannelSummary &summary)
+{
+	foreach(quint64 trigram, trigrams(summary.title))
+	{
+		QHash<quint64, QSet<QString> >::iterator i = list.titles.find(trigram);
+		if(i == list.titles.end())
+		{
+			continue;
+		}
+		i->remove(summary.name);
+		if(i->isEmpty())
+		{
+			list.titles.erase(i);
+		}
+	}
+}
+
+void FChannelListModel::setMatched(List &list, Row &row, bool matched)
+{
+	row.matched = matched;
+	if(matched)
+	{
+		list.matches.insert(row.summary.name);
+	}
+	else
+	{
+		list.matches.remove(row.summary.name);
+	}
+}
+
+bool FChannelListModel::titleMatches(const FChannelSummary &summary) const
+{
+	return matchfilter.isEmpty() || summary.title.contains(matchfilter, Qt::CaseInsensitive);
+}
+
+void FChannelListModel::setTitleFilter(const QString &text)
+{
+	filter = text;
+	// Clearing the filter leaves the rows matched against the last one, so
+	// typing it again, or more of it, starts from there.
+	if(text.isEmpty() || text == matchfilter)
+	{
+		return;
+	}
+	matchfilter = text;
+	QVector<quint64> wanted = trigrams(text);
+	refilter(rooms, wanted);
+	refilter(channels, wanted);
+}
+
+void FChannelListModel::refilter(List &list, const QVector<quint64> &wanted)
+{
+	// Filters shorter than a trigram have to look at every title.
+	if(wanted.isEmpty())
+	{
+		for(std::vector<Row>::iterator i = list.rows.begin(); i != list.rows.end(); i++)
+		{
+			setMatched(list, *i, titleMatches(i->summary));
+		}
+		return;
+	}
+
+	// A title can only contain the filter if it has every one of the
+	// filter's trigrams, so intersect their postings, smallest first.
+	QList<const QSet<QString> *> postings;
+	foreach(quint64 trigram, wanted)
+	{
+		QHash<quint64, QSet<QString> >::const_iterator i = list.titles.constFind(trigram);
+		if(i == list.titles.constEnd())
+		{
+			postings.clear();
+			break;
+		}
+		postings.append(&i.value());
+	}
+	std::sort(postings.begin(), postings.end(), [](const QSet<QString> *a, const QSet<QString> *b) { return a->size() < b->size(); });
+	QSet<QString> candidates;
+	if(!postings.isEmpty())
+	{
+		candidates = *postings.first();
+		for(int i = 1; i < postings.size() && !candidates.isEmpty(); i++)
+		{
+			candidates.intersect(*postings[i]);
+		}
+	}
+
+	// The trigrams can all be there without being next to each other, so the candidates are still checked.
+	QSet<QString> matches;
+	foreach(const QString &name, candidates)
+	{
+		if(titleMatches(list.rows[list.positions.value(name)].summary))
+		{
+			matches.insert(name);
+		}
+	}
+
+	// Only the rows that enter or leave the match set change.
+	foreach(const QString &name, list.matches)
+	{
+		if(!matches.contains(name))
+		{
+			list.rows[list.positions.value(name)].matched = false;
+		}
+	}
+	foreach(const QString &name, matches)
+	{
+		if(!list.matches.contains(name))
+		{
+			list.rows[list.positions.value(name)].matched = true;
+		}
+	}
+	list.matches = matches;
 }
 
 FChannelListSortProxy::FChannelListSortProxy(QObject *parent) :
@@ -106,16 +354,15 @@ FChannelListSortProxy::FChannelListSortProxy(QObject *parent) :
 {
 	setDynamicSortFilter(true);
 	setSortRole(FChannelListModel::SortKeyRole);
-	setFilterRole(FChannelListModel::SortKeyRole);
-	setFilterKeyColumn(FChannelListModel::colTitle);
 	setSortLocaleAware(true);
 	setSortCaseSensitivity(Qt::CaseInsensitive);
-	setFilterCaseSensitivity(Qt::CaseInsensitive);
 }
 
 bool FChannelListSortProxy::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
-	if (!QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent))
+	// The title filter is answered by the model's index instead of matching every row here.
+	FChannelListModel *model = static_cast<FChannelListModel*>(sourceModel());
+	if (!model->matchesFilter(source_row))
 	{ return false; }
 
 	if (_showType == FChannelSummary::Unknown) { return true; }
@@ -136,6 +383,12 @@ void FChannelListSortProxy::setShowType(FChannelSummary::Type t)
 	invalidate();
 }
 
+void FChannelListSortProxy::setTitleFilter(const QString &text)
+{
+	static_cast<FChannelListModel*>(sourceModel())->setTitleFilter(text);
+	invalidateFilter();
+}
+
 FChannelListDialog::FChannelListDialog(FChannelListModel *m, QWidget *parent = 0) : QDialog(parent), Ui::FChannelListDialogUi()
 {
 	setupUi(this);
@@ -185,7 +438,7 @@ void FChannelListDialog::on_buttonBox_accepted()
 
 void FChannelListDialog::on_chFilterText_textChanged(const QString &text)
 {
-	datasort->setFilterFixedString(text);
+	datasort->setTitleFilter(text);
 }
 
 void FChannelListDialog::on_chTypeBoth_toggled(bool active)
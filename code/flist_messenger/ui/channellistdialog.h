@@ -3,6 +3,9 @@
 #include <QSortFilterProxyModel>
 #include <QIcon>
 #include <QPushButton>
+#include <QHash>
+#include <QSet>
+#include <QVector>
 #include <vector>
 
 #include "flist_channelsummary.h"
@@ -31,27 +34,57 @@ public:
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
 	const FChannelSummary &byIndex(uint index) const;
   
+	// The lists are merged into what is already shown rather than replacing
+	// it, so the views only hear about the rooms that came, went or changed.
 	template<class InputIterator>
 	void updateChannels(InputIterator first, InputIterator last)
 	{
-		beginResetModel();
-		channels.clear();
-		channels.assign(first, last);
-		endResetModel();
+		merge(channels, rooms.rows.size(), std::vector<FChannelSummary>(first, last));
 	}
 
 	template<class InputIterator>
 	void updateRooms(InputIterator first, InputIterator last)
 	{
-		beginResetModel();
-		rooms.clear();
-		rooms.assign(first, last);
-		endResetModel();
+		merge(rooms, 0, std::vector<FChannelSummary>(first, last));
 	}
 
+	// Only rows whose title contains 'text' pass matchesFilter(). Only the
+	// rows that start or stop matching are touched.
+	void setTitleFilter(const QString &text);
+	bool matchesFilter(uint index) const;
+
 private:
-	std::vector<FChannelSummary> channels;
-	std::vector<FChannelSummary> rooms;
+	struct Row
+	{
+		Row(const FChannelSummary &summary) : summary(summary), matched(true) {}
+		FChannelSummary summary;
+		bool matched;	// Whether the title passes 'matchfilter'.
+	};
+
+	// The channels or the rooms, and what the title filter needs to find their rows.
+	struct List
+	{
+		std::vector<Row> rows;
+		QHash<QString, int> positions;	// Where each name is in 'rows'.
+		// Names by the case folded trigrams in their titles. Typing a
+		// filter then only looks at the rows sharing all of its trigrams.
+		QHash<quint64, QSet<QString> > titles;
+		QSet<QString> matches;	// Names of the rows with 'matched' set.
+	};
+
+	void merge(List &list, int offset, const std::vector<FChannelSummary> &fresh);
+	void refilter(List &list, const QVector<quint64> &wanted);
+	const Row &rowByIndex(uint index) const;
+	bool titleMatches(const FChannelSummary &summary) const;
+	static void setMatched(List &list, Row &row, bool matched);
+	static void indexTitle(List &list, const FChannelSummary &summary);
+	static void unindexTitle(List &list, const FChannelSummary &summary);
+	static QVector<quint64> trigrams(const QString &text);
+
+	List channels;
+	List rooms;
+	QString filter;	// As typed. An empty filter lets every row through.
+	QString matchfilter;	// The last filter that wasn't empty, kept so clearing and retyping it is free.
 	QIcon hash;
 	QIcon key;
 };
@@ -63,6 +96,7 @@ public:
 	FChannelListSortProxy(QObject * parent = 0);
 	FChannelSummary::Type showType();
 	void setShowType(FChannelSummary::Type t);
+	void setTitleFilter(const QString &text);
 
 protected:
 	virtual bool filterAcceptsRow(int source_row, const QModelIndex & source_parent) const;
@@ -7,6 +7,9 @@
 #include <QLabel>
 #include <QTabWidget>
 
+#include "flist_global.h"
+#include "flist_characterprofile.h"
+
 namespace Ui
 {
 	class FCharacterInfoDialogUi
@@ -66,6 +69,8 @@ FCharacterInfoDialog::FCharacterInfoDialog(QWidget *parent) :
 	ui(new Ui::FCharacterInfoDialogUi)
 {
 	ui->setupUi(this);
+	connect(characterprofiles, SIGNAL(profileReady(QString)), this, SLOT(profileReady(QString)));
+	connect(characterprofiles, SIGNAL(profileFailed(QString,QString)), this, SLOT(profileFailed(QString,QString)));
 }
 
 FCharacterInfoDialog::~FCharacterInfoDialog()
@@ -79,25 +84,46 @@ void FCharacterInfoDialog::setDisplayedCharacter(FCharacter *c)
 	ui->name->setText(name);
 
 	ui->status->setText(c->statusMsg());
-	updateProfile(c);
-	updateKinks(c);
+	displayed = c->name().toLower();
+	showProfile();
+}
+
+void FCharacterInfoDialog::showProfile()
+{
+	FCharacterProfileData profile = characterprofiles->profile(displayed);
+	if(profile.isNull())
+	{
+		ui->profileTab->setPlainText(QString("Loading profile..."));
+		ui->kinkTab->clear();
+		characterprofiles->request(displayed);
+		return;
+	}
+	updateKeyValues(profile.info, ui->profileTab);
+	updateKeyValues(profile.customkinks, ui->kinkTab);
 }
 
-void FCharacterInfoDialog::updateProfile(FCharacter *c)
+void FCharacterInfoDialog::profileReady(QString name)
 {
-	updateKeyValues(c->getProfileDataKeys(), c->getProfileData(), ui->profileTab);
+	if(name == displayed)
+	{
+		showProfile();
+	}
 }
 
-void FCharacterInfoDialog::updateKinks(FCharacter *c)
+void FCharacterInfoDialog::profileFailed(QString name, QString error)
 {
-	updateKeyValues(c->getCustomKinkDataKeys(), c->getCustomKinkData(), ui->kinkTab);
+	// Keep showing a stale profile if there is one.
+	if(name == displayed && characterprofiles->profile(displayed).isNull())
+	{
+		ui->profileTab->setPlainText(QString("Could not load the profile: %1").arg(error));
+	}
 }
 
-void FCharacterInfoDialog::updateKeyValues(QStringList &k, QHash<QString,QString> &kv, QTextEdit *te)
+void FCharacterInfoDialog::updateKeyValues(const QList<QPair<QString,QString> > &kv, QTextEdit *te)
 {
 	te->clear();
-	foreach(QString key, k)
+	for(int i = 0; i < kv.size(); i++)
 	{
-		te->append(QString("<b>%1:</b> %2").arg(key).arg(kv[key]));
+		te->append(QString("<b>%1:</b> %2").arg(kv.at(i).first.toHtmlEscaped()).arg(kv.at(i).second.toHtmlEscaped()));
 	}
 }
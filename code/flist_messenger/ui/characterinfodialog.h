@@ -4,6 +4,8 @@
 #include <QDialog>
 #include <QHash>
 #include <QTextEdit>
+#include <QList>
+#include <QPair>
 
 #include "flist_character.h"
 
@@ -20,17 +22,21 @@ public:
 	~FCharacterInfoDialog();
 
 	void setDisplayedCharacter(FCharacter *c);
-	void updateProfile(FCharacter *c);
-	void updateKinks(FCharacter *c);
 
 signals:
 
 public slots:
 
+private slots:
+	void profileReady(QString name);
+	void profileFailed(QString name, QString error);
+
 private:
 	Ui::FCharacterInfoDialogUi *ui;
+	QString displayed; // Lower case name of the character on display.
 
-	void updateKeyValues(QStringList &k, QHash<QString,QString> &kv, QTextEdit *te);
+	void showProfile();
+	void updateKeyValues(const QList<QPair<QString,QString> > &kv, QTextEdit *te);
 };
 
 #endif // FLIST_CHARACTERINFODIALOG_H
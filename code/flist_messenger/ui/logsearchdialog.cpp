@@ -0,0 +1,113 @@
+#include "ui/logsearchdialog.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QTextBrowser>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QDateTime>
+
+namespace Ui
+{
+	class FLogSearchDialogUi
+	{
+	public:
+		QVBoxLayout *vbl;
+		QHBoxLayout *hbl;
+		QLineEdit *query;
+		QPushButton *searchButton;
+		QLabel *status;
+		QTextBrowser *results;
+		QDialogButtonBox *buttons;
+		QPushButton *closeButton;
+
+		void setupUi(QDialog *dialog)
+		{
+			vbl = new QVBoxLayout(dialog);
+
+			hbl = new QHBoxLayout();
+			query = new QLineEdit(dialog);
+			query->setPlaceholderText(QString("Name, words, or a \"quoted phrase\""));
+			hbl->addWidget(query);
+			searchButton = new QPushButton(QString("Search"), dialog);
+			searchButton->setDefault(true);
+			hbl->addWidget(searchButton);
+			vbl->addLayout(hbl);
+
+			status = new QLabel(dialog);
+			vbl->addWidget(status);
+
+			results = new QTextBrowser(dialog);
+			results->setOpenLinks(false);
+			vbl->addWidget(results);
+
+			buttons = new QDialogButtonBox(Qt::Horizontal, dialog);
+			closeButton = new QPushButton(QIcon(":/images/cross.png"), QString("Close"));
+			buttons->addButton(closeButton, QDialogButtonBox::RejectRole);
+			vbl->addWidget(buttons);
+
+			dialog->setLayout(vbl);
+			dialog->setWindowTitle(QString("Search Logs"));
+			dialog->resize(600, 450);
+
+			QObject::connect(buttons, SIGNAL(rejected()), dialog, SLOT(reject()));
+			QObject::connect(searchButton, SIGNAL(clicked()), dialog, SLOT(search()));
+			QObject::connect(query, SIGNAL(returnPressed()), dialog, SLOT(search()));
+		}
+	};
+}
+
+FLogSearchDialog::FLogSearchDialog(QWidget *parent) :
+	QDialog(parent),
+	ui(new Ui::FLogSearchDialogUi)
+{
+	ui->setupUi(this);
+}
+
+FLogSearchDialog::~FLogSearchDialog()
+{
+	delete ui;
+}
+
+void FLogSearchDialog::setQuery(QString query)
+{
+	ui->query->setText(query);
+}
+
+void FLogSearchDialog::search()
+{
+	pendingquery = ui->query->text().trimmed();
+	if(pendingquery.isEmpty()) {
+		return;
+	}
+	ui->status->setText(QString("Searching..."));
+	emit searchRequested(pendingquery);
+}
+
+void FLogSearchDialog::showResults(QString query, QList<FLogSearchHit> hits)
+{
+	if(query != pendingquery) {
+		// A newer search is still on its way.
+		return;
+	}
+	ui->status->setText(QString("%1 result(s) for <b>%2</b>").arg(hits.count()).arg(query.toHtmlEscaped()));
+	QString html;
+	foreach(const FLogSearchHit &hit, hits) {
+		html += QString("<small>[%1]</small> <i>%2</i> %3<br />")
+			.arg(QDateTime::fromMSecsSinceEpoch(hit.record.timestamp).toString("yyyy-MM-dd"))
+			.arg(hit.record.panel.section("|||", -1).toHtmlEscaped())
+			.arg(hit.record.html);
+	}
+	ui->results->setHtml(html);
+}
+
+void FLogSearchDialog::showIndexingProgress(int remaining)
+{
+	if(remaining > 0) {
+		ui->status->setText(QString("Indexing old logs, %1 file(s) to go. Results may be incomplete.").arg(remaining));
+	} else {
+		ui->status->setText(QString());
+	}
+}
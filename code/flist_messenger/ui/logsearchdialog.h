@@ -0,0 +1,36 @@
+#ifndef FLIST_LOGSEARCHDIALOG_H
+#define FLIST_LOGSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QList>
+
+#include "flist_logsearch.h"
+
+namespace Ui
+{
+	class FLogSearchDialogUi;
+}
+
+class FLogSearchDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	explicit FLogSearchDialog(QWidget *parent = 0);
+	~FLogSearchDialog();
+
+	void setQuery(QString query);
+
+signals:
+	void searchRequested(QString query);
+
+public slots:
+	void search();
+	void showResults(QString query, QList<FLogSearchHit> hits);
+	void showIndexingProgress(int remaining);
+
+private:
+	Ui::FLogSearchDialogUi *ui;
+	QString pendingquery;
+};
+
+#endif // FLIST_LOGSEARCHDIALOG_H